@@ -0,0 +1,590 @@
+#include "body.h"
+#include "forces.h"
+#include "list.h"
+#include "polygon.h"
+#include "scene.h"
+#include "sdl_wrapper.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Headless benchmark for the physics engine.
+ * Builds the demo scenes without opening a window and steps them
+ * for a fixed number of ticks at a fixed dt.
+ *
+ * Usage: bin/bench [-t ticks] [-d dt] [-s scale] [-r seed] [-b broadphase]
+ *                  [scene ...]
+ * Scenes: nbodies, pegs, breakout, spaceinvaders, damping, marbles
+ * (default: all).
+ * Broadphases: none, grid, sap, tree (default: the scene's default).
+ * The scale multiplies the number of bodies in each scene.
+ * Each scene runs in its own child process, so the peak resident set size
+ * reported for it is not inflated by the scenes run before it.
+ *
+ * Bodies that can be removed are created with NULL info,
+ * since scene_tick() exits when it removes a body with non-NULL info.
+ */
+
+const size_t BENCH_DEFAULT_TICKS = 1000;
+const double BENCH_DEFAULT_DT = 1.0 / 60;
+const unsigned BENCH_DEFAULT_SEED = 1;
+const double NS_PER_S = 1e9;
+const rgb_color_t BENCH_COLOR = {0, 0, 0};
+
+// nbodies
+const size_t NBODIES_STARS = 40;
+const size_t NBODIES_STAR_POINTS = 8;
+const double NBODIES_GRAVITY = 1000;
+const vector_t NBODIES_MAX = {.x = 2000, .y = 1000};
+
+// damping
+const size_t DAMPING_BALLS = 50;
+const size_t DAMPING_BALL_POINTS = 7;
+const double DAMPING_RADIUS = 20;
+const double DAMPING_SPRING = 100;
+const double DAMPING_GAMMA = 4;
+
+// pegs
+const size_t PEGS_ROWS = 11;
+const size_t PEGS_CIRCLE_POINTS = 40;
+const double PEGS_WIDTH = 80;
+const double PEGS_HEIGHT = 80;
+const double PEGS_ROW_SPACING = 3.6;
+const double PEGS_COL_SPACING = 3.5;
+const double PEGS_PEG_RADIUS = 0.5;
+const double PEGS_BALL_RADIUS = 1;
+const double PEGS_BALL_MASS = 2;
+const double PEGS_PEG_ELASTICITY = 0.3;
+const double PEGS_BALL_ELASTICITY = 0.7;
+const double PEGS_DROP_INTERVAL = 1;
+const double PEGS_GRAVITY = -9.8;
+const vector_t PEGS_START_VELOCITY = {.x = 0, .y = -8};
+
+// breakout
+const size_t BREAKOUT_BRICKS_PER_ROW = 10;
+const size_t BREAKOUT_ROWS = 3;
+const double BREAKOUT_BRICK_WIDTH = 190;
+const double BREAKOUT_BRICK_HEIGHT = 50;
+const double BREAKOUT_BALL_RADIUS = 10;
+const double BREAKOUT_BALL_MASS = 10;
+const size_t BREAKOUT_BALL_POINTS = 8;
+const vector_t BREAKOUT_BALL_VELOCITY = {.x = -300, .y = 600};
+const vector_t BREAKOUT_MAX = {.x = 2000, .y = 1000};
+const double BREAKOUT_WALL_WIDTH = 10;
+
+// spaceinvaders
+const size_t INVADERS_PER_ROW = 8;
+const size_t INVADERS_ROWS = 3;
+const double INVADERS_RADIUS = 80;
+const size_t INVADERS_ARC_POINTS = 5;
+const vector_t INVADERS_VELOCITY = {.x = 100, .y = 0};
+const vector_t INVADERS_MAX = {.x = 2000, .y = 1000};
+const double INVADERS_BULLET_RADIUS = 10;
+const size_t INVADERS_BULLET_POINTS = 8;
+const double INVADERS_BULLET_MASS = 10;
+const vector_t INVADERS_BULLET_VELOCITY = {.x = 0, .y = 1000};
+const double INVADERS_FIRE_INTERVAL = 0.1;
+const double INVADERS_MASS = 100;
+
+// marbles
+const size_t MARBLES_BALLS = 80;
+const size_t MARBLES_BALL_POINTS = 12;
+const double MARBLES_RADIUS = 10;
+const double MARBLES_MASS = 1;
+const double MARBLES_SPACING = 60;
+const double MARBLES_MAX_SPEED = 200;
+const double MARBLES_ELASTICITY = 0.9;
+const double MARBLES_GRAVITY = -500;
+const double MARBLES_WALL_HEIGHT = 100;
+
+typedef struct bench_state {
+  scene_t *scene;
+  size_t scale;
+  double time_since_spawn;
+  size_t n_spawned;
+  // Scene-specific bookkeeping, e.g. the bodies new bodies interact with,
+  // or handles to them if the scene may free them
+  list_t *targets;
+} bench_state_t;
+
+typedef struct bench_scene {
+  const char *name;
+  void (*init)(bench_state_t *state);
+  // Called before every scene_tick(), e.g. to spawn bodies
+  void (*update)(bench_state_t *state, double dt);
+} bench_scene_t;
+
+// The demos play sounds from some collision handlers; the benchmark is silent
+int load_sound_effect(char *filename) { return 0; }
+
+char *get_sound_effect(void *sound) { return NULL; }
+
+/**
+ * Fills points with a regular polygon around center.
+ */
+void make_regular_polygon(vector_t *points, size_t n, vector_t center,
+                          double radius) {
+  for (size_t i = 0; i < n; i++) {
+    vector_t v = {.x = 0, .y = radius};
+    points[i] = vec_add(center, vec_rotate(v, 2 * M_PI / n * i));
+  }
+}
+
+body_t *make_regular_body(size_t n, vector_t center, double radius,
+                          double mass) {
+  vector_t points[n];
+  make_regular_polygon(points, n, center, radius);
+  return body_init_from_array(points, n, mass, BENCH_COLOR);
+}
+
+body_t *make_rect_body(vector_t center, double width, double height,
+                       double mass) {
+  vector_t points[4] = {
+      {.x = center.x - width / 2, .y = center.y + height / 2},
+      {.x = center.x - width / 2, .y = center.y - height / 2},
+      {.x = center.x + width / 2, .y = center.y - height / 2},
+      {.x = center.x + width / 2, .y = center.y + height / 2},
+  };
+  return body_init_from_array(points, 4, mass, BENCH_COLOR);
+}
+
+double rand_range(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+void nbodies_init(bench_state_t *state) {
+  scene_t *scene = state->scene;
+  size_t n_stars = NBODIES_STARS * state->scale;
+  for (size_t i = 0; i < n_stars; i++) {
+    double radius = rand_range(15, 65);
+    vector_t center = {
+        .x = rand_range(NBODIES_MAX.x / 4, NBODIES_MAX.x * 3 / 4),
+        .y = rand_range(NBODIES_MAX.y / 4, NBODIES_MAX.y * 3 / 4)};
+    body_t *star =
+        make_regular_body(NBODIES_STAR_POINTS, center, radius, radius * 10);
+    body_set_velocity(star, (vector_t){.x = 1, .y = 1});
+    scene_add_body(scene, star);
+  }
+  for (size_t j = 0; j < n_stars; j++) {
+    for (size_t k = j + 1; k < n_stars; k++) {
+      create_newtonian_gravity(scene, NBODIES_GRAVITY,
+                               scene_get_body(scene, j),
+                               scene_get_body(scene, k));
+    }
+  }
+}
+
+void damping_init(bench_state_t *state) {
+  scene_t *scene = state->scene;
+  size_t n_balls = DAMPING_BALLS * state->scale;
+  for (size_t i = 0; i < n_balls; i++) {
+    double x = (2 * i + 1) * DAMPING_RADIUS;
+    body_t *ball =
+        body_init_circle((vector_t){.x = x, .y = 200}, DAMPING_RADIUS,
+                         DAMPING_BALL_POINTS, 2 * i + 2, BENCH_COLOR);
+    body_t *anchor =
+        body_init_circle((vector_t){.x = x, .y = 500}, DAMPING_RADIUS,
+                         DAMPING_BALL_POINTS, INFINITY, BENCH_COLOR);
+    scene_add_body(scene, ball);
+    scene_add_body(scene, anchor);
+    create_drag(scene, DAMPING_GAMMA, ball);
+    create_spring(scene, DAMPING_SPRING, ball, anchor);
+  }
+}
+
+void pegs_init(bench_state_t *state) {
+  scene_t *scene = state->scene;
+  state->targets = list_init(PEGS_ROWS * PEGS_ROWS, NULL);
+  // Scaling widens the board with more columns of pegs
+  size_t n_boards = state->scale;
+  for (size_t b = 0; b < n_boards; b++) {
+    double offset = b * PEGS_WIDTH;
+    for (size_t i = 1; i <= PEGS_ROWS; i++) {
+      for (size_t j = 0; j <= i; j++) {
+        vector_t center = {
+            .x = offset + PEGS_WIDTH / 2 + (j - i * 0.5) * PEGS_COL_SPACING,
+            .y = PEGS_HEIGHT - (i + 1) * PEGS_ROW_SPACING};
+        body_t *peg = body_init_circle(center, PEGS_PEG_RADIUS,
+                                       PEGS_CIRCLE_POINTS, INFINITY,
+                                       BENCH_COLOR);
+        scene_add_body(scene, peg);
+        list_add(state->targets, peg);
+      }
+    }
+  }
+  body_t *ground = make_rect_body(
+      (vector_t){.x = n_boards * PEGS_WIDTH / 2, .y = 0.5},
+      n_boards * PEGS_WIDTH, 1, INFINITY);
+  scene_add_body(scene, ground);
+  list_add(state->targets, ground);
+}
+
+void pegs_update(bench_state_t *state, double dt) {
+  state->time_since_spawn += dt;
+  if (state->time_since_spawn < PEGS_DROP_INTERVAL / state->scale)
+    return;
+  state->time_since_spawn = 0;
+  scene_t *scene = state->scene;
+  size_t board = state->n_spawned++ % state->scale;
+  vector_t center = {.x = board * PEGS_WIDTH + PEGS_WIDTH / 2 +
+                          rand_range(-0.5, 0.5),
+                     .y = PEGS_HEIGHT - 3};
+  body_t *ball = body_init_circle(center, PEGS_BALL_RADIUS, PEGS_CIRCLE_POINTS,
+                                  PEGS_BALL_MASS, BENCH_COLOR);
+  body_set_velocity(ball, PEGS_START_VELOCITY);
+  for (size_t i = 0; i < list_size(state->targets); i++) {
+    body_t *target = list_get(state->targets, i);
+    double elasticity = body_get_mass(target) == INFINITY
+                            ? PEGS_PEG_ELASTICITY
+                            : PEGS_BALL_ELASTICITY;
+    create_physics_collision(scene, elasticity, ball, target);
+  }
+  create_universal_gravity(scene, ball, PEGS_GRAVITY * PEGS_BALL_MASS);
+  scene_add_body(scene, ball);
+  list_add(state->targets, ball);
+}
+
+void breakout_init(bench_state_t *state) {
+  scene_t *scene = state->scene;
+  body_t *ball = body_init_circle((vector_t){.x = 1035, .y = 135},
+                                  BREAKOUT_BALL_RADIUS, BREAKOUT_BALL_POINTS,
+                                  BREAKOUT_BALL_MASS, BENCH_COLOR);
+  body_set_velocity(ball, BREAKOUT_BALL_VELOCITY);
+  body_set_bullet(ball, true);
+  body_t *paddle = make_rect_body((vector_t){.x = 1000, .y = 100},
+                                  BREAKOUT_BRICK_WIDTH, BREAKOUT_BRICK_HEIGHT,
+                                  INFINITY);
+  scene_add_body(scene, paddle);
+  create_physics_collision(scene, 1, ball, paddle);
+  // Scaling adds rows of bricks below the first three
+  size_t n_rows = BREAKOUT_ROWS * state->scale;
+  double brick_spacing = BREAKOUT_MAX.x / BREAKOUT_BRICKS_PER_ROW;
+  for (size_t i = 0; i < n_rows * BREAKOUT_BRICKS_PER_ROW; i++) {
+    size_t row = i / BREAKOUT_BRICKS_PER_ROW;
+    vector_t center = {
+        .x = BREAKOUT_BRICK_WIDTH / 2 +
+             brick_spacing * (i % BREAKOUT_BRICKS_PER_ROW),
+        .y = BREAKOUT_MAX.y - BREAKOUT_BRICK_HEIGHT * (row + 1) * 0.6};
+    body_t *brick = make_rect_body(center, BREAKOUT_BRICK_WIDTH,
+                                   BREAKOUT_BRICK_HEIGHT * 0.5, INFINITY);
+    scene_add_body(scene, brick);
+    create_physics_collision(scene, 1, ball, brick);
+    create_one_sided_destructive_collision(scene, ball, brick);
+  }
+  body_t *walls[3] = {
+      make_rect_body((vector_t){.x = BREAKOUT_WALL_WIDTH / 2,
+                                .y = BREAKOUT_MAX.y / 2},
+                     BREAKOUT_WALL_WIDTH, BREAKOUT_MAX.y, INFINITY),
+      make_rect_body((vector_t){.x = BREAKOUT_MAX.x / 2,
+                                .y = BREAKOUT_MAX.y - BREAKOUT_WALL_WIDTH / 2},
+                     BREAKOUT_MAX.x, BREAKOUT_WALL_WIDTH, INFINITY),
+      make_rect_body((vector_t){.x = BREAKOUT_MAX.x - BREAKOUT_WALL_WIDTH / 2,
+                                .y = BREAKOUT_MAX.y / 2},
+                     BREAKOUT_WALL_WIDTH, BREAKOUT_MAX.y, INFINITY),
+  };
+  for (size_t i = 0; i < 3; i++) {
+    scene_add_body(scene, walls[i]);
+    create_physics_collision(scene, 1, ball, walls[i]);
+  }
+  scene_add_body(scene, ball);
+  state->targets = list_init(1, NULL);
+  list_add(state->targets, ball);
+}
+
+void breakout_update(bench_state_t *state, double dt) {
+  // Keep the paddle under the ball so the rally never ends
+  body_t *ball = list_get(state->targets, 0);
+  body_t *paddle = scene_get_body(state->scene, 0);
+  vector_t paddle_center = body_get_centroid(paddle);
+  paddle_center.x = body_get_centroid(ball).x;
+  body_set_centroid(paddle, paddle_center);
+}
+
+void invaders_add_wave(bench_state_t *state) {
+  scene_t *scene = state->scene;
+  size_t n_rows = INVADERS_ROWS * state->scale;
+  double spacing = INVADERS_MAX.x / INVADERS_PER_ROW;
+  for (size_t i = 0; i < n_rows * INVADERS_PER_ROW; i++) {
+    size_t row = i / INVADERS_PER_ROW;
+    vector_t center = {.x = 2 * INVADERS_RADIUS +
+                            spacing * (i % INVADERS_PER_ROW),
+                       .y = INVADERS_MAX.y - INVADERS_RADIUS * (row + 1) /
+                                                 state->scale};
+    body_t *enemy = make_regular_body(INVADERS_ARC_POINTS, center,
+                                      INVADERS_RADIUS, INVADERS_MASS);
+    body_set_velocity(enemy, INVADERS_VELOCITY);
+    scene_add_body(scene, enemy);
+    // Enemies are freed by the scene once shot, so track them by handle
+    body_handle_t *handle = malloc(sizeof(body_handle_t));
+    assert(handle);
+    *handle = scene_get_body_handle(scene, enemy);
+    list_add(state->targets, handle);
+  }
+}
+
+bool invaders_enemy_is_gone(void *handle, void *scene) {
+  return scene_resolve_body(scene, *(body_handle_t *)handle) == NULL;
+}
+
+void invaders_init(bench_state_t *state) {
+  state->targets = list_init(INVADERS_PER_ROW * INVADERS_ROWS, free);
+  invaders_add_wave(state);
+}
+
+/**
+ * Bounces the enemies off the side walls and fires a volley of bullets
+ * from across the bottom of the screen at a fixed rate.
+ */
+void invaders_update(bench_state_t *state, double dt) {
+  scene_t *scene = state->scene;
+  // Drop enemies that were shot on the previous tick
+  list_remove_if(state->targets, invaders_enemy_is_gone, scene);
+  for (size_t i = 0; i < list_size(state->targets); i++) {
+    body_handle_t *handle = list_get(state->targets, i);
+    body_t *enemy = scene_resolve_body(scene, *handle);
+    vector_t centroid = body_get_centroid(enemy);
+    vector_t velocity = body_get_velocity(enemy);
+    if ((centroid.x < INVADERS_RADIUS && velocity.x < 0) ||
+        (centroid.x > INVADERS_MAX.x - INVADERS_RADIUS && velocity.x > 0))
+      body_set_velocity(enemy, vec_negate(velocity));
+  }
+  if (list_size(state->targets) == 0)
+    invaders_add_wave(state);
+
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (body_get_centroid(body).y > INVADERS_MAX.y + INVADERS_RADIUS)
+      body_remove(body);
+  }
+
+  state->time_since_spawn += dt;
+  if (state->time_since_spawn < INVADERS_FIRE_INTERVAL)
+    return;
+  state->time_since_spawn = 0;
+  vector_t center = {.x = rand_range(0, INVADERS_MAX.x), .y = 0};
+  body_t *bullet = make_regular_body(INVADERS_BULLET_POINTS, center,
+                                     INVADERS_BULLET_RADIUS,
+                                     INVADERS_BULLET_MASS);
+  body_set_velocity(bullet, INVADERS_BULLET_VELOCITY);
+  body_set_bullet(bullet, true);
+  for (size_t i = 0; i < list_size(state->targets); i++) {
+    body_handle_t *handle = list_get(state->targets, i);
+    create_destructive_collision(scene, bullet,
+                                 scene_resolve_body(scene, *handle));
+  }
+  scene_add_body(scene, bullet);
+}
+
+/**
+ * Rolls marbles back and forth along a long, narrow track, with every
+ * marble solid to every other. Nearly all of the pairs are far apart along
+ * the track, the case sweep-and-prune along the x axis is made for.
+ */
+void marbles_init(bench_state_t *state) {
+  scene_t *scene = state->scene;
+  size_t n_balls = MARBLES_BALLS * state->scale;
+  double length = n_balls * MARBLES_SPACING;
+  body_t *bounds[3] = {
+      make_rect_body((vector_t){.x = length / 2, .y = -MARBLES_RADIUS},
+                     length, 2 * MARBLES_RADIUS, INFINITY),
+      make_rect_body((vector_t){.x = -MARBLES_RADIUS,
+                                .y = MARBLES_WALL_HEIGHT / 2},
+                     2 * MARBLES_RADIUS, MARBLES_WALL_HEIGHT, INFINITY),
+      make_rect_body((vector_t){.x = length + MARBLES_RADIUS,
+                                .y = MARBLES_WALL_HEIGHT / 2},
+                     2 * MARBLES_RADIUS, MARBLES_WALL_HEIGHT, INFINITY),
+  };
+  for (size_t i = 0; i < 3; i++)
+    scene_add_body(scene, bounds[i]);
+  state->targets = list_init(n_balls + 3, NULL);
+  for (size_t i = 0; i < 3; i++)
+    list_add(state->targets, bounds[i]);
+  for (size_t i = 0; i < n_balls; i++) {
+    vector_t center = {.x = (i + 0.5) * MARBLES_SPACING,
+                       .y = rand_range(MARBLES_RADIUS, 3 * MARBLES_RADIUS)};
+    body_t *ball = body_init_circle(center, MARBLES_RADIUS,
+                                    MARBLES_BALL_POINTS, MARBLES_MASS,
+                                    BENCH_COLOR);
+    body_set_velocity(
+        ball, (vector_t){.x = rand_range(-MARBLES_MAX_SPEED, MARBLES_MAX_SPEED),
+                         .y = 0});
+    for (size_t j = 0; j < list_size(state->targets); j++)
+      create_physics_collision(scene, MARBLES_ELASTICITY, ball,
+                               list_get(state->targets, j));
+    create_universal_gravity(scene, ball, MARBLES_GRAVITY * MARBLES_MASS);
+    scene_add_body(scene, ball);
+    list_add(state->targets, ball);
+  }
+}
+
+// Indexed by broadphase_kind_t
+const char *BROADPHASE_NAMES[] = {"none", "grid", "sap", "tree"};
+const size_t NUM_BROADPHASES =
+    sizeof(BROADPHASE_NAMES) / sizeof(BROADPHASE_NAMES[0]);
+
+const bench_scene_t BENCH_SCENES[] = {
+    {.name = "nbodies", .init = nbodies_init, .update = NULL},
+    {.name = "pegs", .init = pegs_init, .update = pegs_update},
+    {.name = "breakout", .init = breakout_init, .update = breakout_update},
+    {.name = "spaceinvaders", .init = invaders_init, .update = invaders_update},
+    {.name = "damping", .init = damping_init, .update = NULL},
+    {.name = "marbles", .init = marbles_init, .update = NULL},
+};
+const size_t NUM_BENCH_SCENES = sizeof(BENCH_SCENES) / sizeof(bench_scene_t);
+
+double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / NS_PER_S;
+}
+
+/** Returns the peak resident set size of the process so far, in KiB */
+long peak_rss_kib(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+void run_scene(const bench_scene_t *bench_scene, size_t ticks, double dt,
+               size_t scale, int broadphase) {
+  bench_state_t state = {.scene = scene_init(),
+                         .scale = scale,
+                         .time_since_spawn = INFINITY,
+                         .n_spawned = 0,
+                         .targets = NULL};
+  if (broadphase >= 0)
+    scene_set_broadphase(state.scene, (broadphase_kind_t)broadphase);
+  bench_scene->init(&state);
+  size_t initial_bodies = scene_bodies(state.scene);
+  size_t body_ticks = 0;
+  double elapsed = 0;
+  for (size_t t = 0; t < ticks; t++) {
+    if (bench_scene->update != NULL)
+      bench_scene->update(&state, dt);
+    body_ticks += scene_bodies(state.scene);
+    // Only the engine is timed, not the scene's own bookkeeping
+    double start = now_seconds();
+    scene_tick(state.scene, dt);
+    elapsed += now_seconds() - start;
+  }
+  printf("%-14s bodies %6zu -> %-6zu forces %8zu  %10.1f ticks/s  "
+         "%9.1f ns/body-tick  peak RSS %ld KiB\n",
+         bench_scene->name, initial_bodies, scene_bodies(state.scene),
+         scene_forces(state.scene), ticks / elapsed,
+         body_ticks > 0 ? elapsed * NS_PER_S / body_ticks : 0,
+         peak_rss_kib());
+  if (state.targets != NULL)
+    list_free(state.targets);
+  scene_free(state.scene);
+}
+
+/**
+ * Runs a scene with run_scene() in a child process and waits for it,
+ * exiting if the child fails.
+ */
+void run_scene_in_child(const bench_scene_t *bench_scene, size_t ticks,
+                        double dt, size_t scale, int broadphase) {
+  // Anything still buffered would otherwise be printed by both processes
+  fflush(stdout);
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0) {
+    run_scene(bench_scene, ticks, dt, scale, broadphase);
+    fflush(stdout);
+    _exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "scene %s failed\n", bench_scene->name);
+    exit(1);
+  }
+}
+
+void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [-t ticks] [-d dt] [-s scale] [-r seed] "
+          "[-b broadphase] [scene ...]\n"
+          "scenes:",
+          program);
+  for (size_t i = 0; i < NUM_BENCH_SCENES; i++)
+    fprintf(stderr, " %s", BENCH_SCENES[i].name);
+  fprintf(stderr, "\nbroadphases:");
+  for (size_t i = 0; i < NUM_BROADPHASES; i++)
+    fprintf(stderr, " %s", BROADPHASE_NAMES[i]);
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  size_t ticks = BENCH_DEFAULT_TICKS;
+  double dt = BENCH_DEFAULT_DT;
+  size_t scale = 1;
+  unsigned seed = BENCH_DEFAULT_SEED;
+  // -1 keeps the scene's default broadphase
+  int broadphase = -1;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:d:s:r:b:h")) != -1) {
+    switch (opt) {
+    case 't':
+      ticks = strtoul(optarg, NULL, 10);
+      break;
+    case 'd':
+      dt = strtod(optarg, NULL);
+      break;
+    case 's':
+      scale = strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      seed = strtoul(optarg, NULL, 10);
+      break;
+    case 'b':
+      for (size_t i = 0; i < NUM_BROADPHASES; i++) {
+        if (strcmp(optarg, BROADPHASE_NAMES[i]) == 0)
+          broadphase = i;
+      }
+      if (broadphase < 0)
+        usage(argv[0]);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (ticks == 0 || scale == 0 || !(dt > 0))
+    usage(argv[0]);
+  for (int j = optind; j < argc; j++) {
+    bool known = false;
+    for (size_t i = 0; i < NUM_BENCH_SCENES; i++)
+      known = known || strcmp(argv[j], BENCH_SCENES[i].name) == 0;
+    if (!known)
+      usage(argv[0]);
+  }
+
+  printf("ticks %zu  dt %g  scale %zu  seed %u  broadphase %s\n", ticks, dt,
+         scale, seed,
+         broadphase >= 0 ? BROADPHASE_NAMES[broadphase] : "default");
+  for (size_t i = 0; i < NUM_BENCH_SCENES; i++) {
+    bool selected = optind == argc;
+    for (int j = optind; j < argc; j++) {
+      if (strcmp(argv[j], BENCH_SCENES[i].name) == 0)
+        selected = true;
+    }
+    if (!selected)
+      continue;
+    srand(seed);
+    run_scene_in_child(&BENCH_SCENES[i], ticks, dt, scale, broadphase);
+  }
+  return 0;
+}
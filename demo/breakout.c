@@ -126,26 +126,6 @@ void add_bricks(scene_t *scene) {
   }
 }
 
-list_t *make_ball_points(vector_t centroid) {
-  list_t *points = list_init(NUM_BALL_POINTS, free);
-  for (size_t i = 0; i < NUM_BALL_POINTS; i++) {
-    vector_t *point = malloc(sizeof(vector_t));
-    assert(point);
-    point->x = centroid.x;
-    point->y = centroid.y + BALL_RADIUS;
-    vector_t v = vec_subtract(*point, centroid);
-    v = vec_rotate(v, (2 * M_PI / NUM_BALL_POINTS) * i);
-    v = vec_add(v, centroid);
-    vector_t *vec = malloc(sizeof(vector_t));
-    assert(vec);
-    vec->x = v.x;
-    vec->y = v.y;
-    point = vec;
-    list_add(points, point);
-  }
-  return points;
-}
-
 vector_t get_initial_ball_position() {
   vector_t difference = {.x = BALL_RADIUS + PADDLE_BRICK_HEIGHT / 2,
                          .y = BALL_RADIUS + PADDLE_BRICK_HEIGHT / 2};
@@ -154,11 +134,13 @@ vector_t get_initial_ball_position() {
 }
 
 void add_ball(scene_t *scene) {
-  list_t *points = make_ball_points(get_initial_ball_position());
-  body_t *ball =
-      body_init_with_info(points, BALL_MASS, PADDLE_BALL_COLOR, BALL, NULL);
-  body_set_centroid(ball, get_initial_ball_position());
+  body_t *ball = body_init_circle_with_info(get_initial_ball_position(),
+                                            BALL_RADIUS, NUM_BALL_POINTS,
+                                            BALL_MASS, PADDLE_BALL_COLOR, BALL,
+                                            NULL);
   body_set_velocity(ball, INITIAL_BALL_VELOCITY);
+  // A long frame must not carry the ball through a brick
+  body_set_bullet(ball, true);
 
   for (size_t i = 0; i < scene_bodies(scene); i++) {
     if (body_get_info(scene_get_body(scene, i)) == BRICK) {
@@ -348,9 +330,8 @@ void emscripten_main(state_t *state) {
   }
   for (size_t i = 0; i < scene_bodies(scene); i++) {
     body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
     if (body_get_info(body) != WALL)
-      sdl_draw_polygon(shape, body_get_color(body));
+      sdl_draw_shape(body_get_shape_view(body), body_get_color(body));
   }
   scene_tick(scene, dt);
   sdl_show();
@@ -30,26 +30,6 @@ typedef struct state {
   scene_t *scene;
 } state_t;
 
-list_t *make_ball_points(vector_t centroid) {
-  list_t *points = list_init(NUM_BALL_POINTS, free);
-  for (size_t i = 0; i < NUM_BALL_POINTS; i++) {
-    vector_t *point = malloc(sizeof(vector_t));
-    assert(point);
-    point->x = centroid.x;
-    point->y = centroid.y + BALL_RADIUS;
-    vector_t v = vec_subtract(*point, centroid);
-    v = vec_rotate(v, (2 * M_PI / NUM_BALL_POINTS) * i);
-    v = vec_add(v, centroid);
-    vector_t *vec = malloc(sizeof(vector_t));
-    assert(vec);
-    vec->x = v.x;
-    vec->y = v.y;
-    point = vec;
-    list_add(points, point);
-  }
-  return points;
-}
-
 body_t *make_ball(size_t i) {
   size_t x_init = 1;
   size_t y_init = 1;
@@ -62,7 +42,6 @@ body_t *make_ball(size_t i) {
     y_init = SDL_MAX.y / 5;
   }
   vector_t initial_point = {.x = x_init, .y = y_init};
-  list_t *points = make_ball_points(initial_point);
 
   float red = fabs(((int)x_init * (int)RED) % 100 / 100.0);
   float blue = fabs(((int)x_init * (int)BLUE) % 100 / 100.0);
@@ -75,7 +54,8 @@ body_t *make_ball(size_t i) {
   if (i % 2 == 0) // balls (even)
     mass = i;
 
-  body_t *result = body_init(points, mass, color);
+  body_t *result = body_init_circle(initial_point, BALL_RADIUS,
+                                    NUM_BALL_POINTS, mass, color);
   // body_set_centroid(result, initial_point);
   body_set_velocity(result, INITIAL_VELOCITY);
   return result;
@@ -114,8 +94,7 @@ void emscripten_main(state_t *state) {
   scene_tick(scene, dt);
   for (size_t i = 0; i < scene_bodies(scene); i = i + 2) {
     body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-    sdl_draw_polygon(shape, body_get_color(body));
+    sdl_draw_shape(body_get_shape_view(body), body_get_color(body));
   }
   sdl_show();
 }
@@ -114,8 +114,7 @@ void emscripten_main(state_t *state) {
   scene_tick(scene, dt);
   for (size_t i = 0; i < scene_bodies(scene); i++) {
     body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-    sdl_draw_polygon(shape, body_get_color(body));
+    sdl_draw_shape(body_get_shape_view(body), body_get_color(body));
   }
   sdl_show();
 }
@@ -230,9 +230,7 @@ void emscripten_main(state_t *state) {
   }
   for (size_t i = 0; i < scene_bodies(state->scene); i++) {
     body_t *body = scene_get_body(state->scene, i);
-    list_t *shape = body_get_shape(body);
-    sdl_draw_polygon(shape, COLOR);
-    list_free(shape);
+    sdl_draw_shape(body_get_shape_view(body), COLOR);
   }
   scene_tick(state->scene, dt);
   sdl_show();
@@ -185,6 +185,7 @@ body_t *spawn_enemy_bullet(scene_t *scene) {
   body_t *result = body_init_with_info(points, BULLET_MASS, BULLET_COLOR,
                                        ENEMY_BULLET, NULL);
   body_set_velocity(result, BULLET_VELOCITY);
+  body_set_bullet(result, true);
   create_destructive_collision(scene, result, get_player(scene));
   return result;
 }
@@ -203,6 +204,7 @@ body_t *spawn_player_bullet(scene_t *scene) {
   body_t *result = body_init_with_info(points, BULLET_MASS, BULLET_COLOR,
                                        PLAYER_BULLET, NULL);
   body_set_velocity(result, vec_multiply(-1, BULLET_VELOCITY));
+  body_set_bullet(result, true);
   for (size_t i = 0; i < scene_bodies(scene); i++) {
     if (body_get_info(scene_get_body(scene, i)) == ENEMY) {
       create_destructive_collision(scene, result, scene_get_body(scene, i));
@@ -322,8 +324,7 @@ void emscripten_main(state_t *state) {
   }
   for (size_t i = 0; i < scene_bodies(scene); i++) {
     body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-    sdl_draw_polygon(shape, body_get_color(body));
+    sdl_draw_shape(body_get_shape_view(body), body_get_color(body));
   }
   scene_tick(scene, dt);
   sdl_show();
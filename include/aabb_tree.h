@@ -0,0 +1,99 @@
+#ifndef __AABB_TREE_H__
+#define __AABB_TREE_H__
+
+#include "polygon.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A dynamic bounding volume tree of axis-aligned boxes.
+ * Each leaf (a "proxy") stores a fattened copy of the box it was given,
+ * so small movements of the box do not change the tree.
+ * The tree is kept balanced by rotations as leaves are inserted and removed.
+ */
+typedef struct aabb_tree aabb_tree_t;
+
+/**
+ * A function called for each proxy found by a query.
+ *
+ * @param aux the auxiliary value passed to aabb_tree_query()
+ * @param data the data stored with the proxy
+ */
+typedef void (*aabb_tree_query_t)(void *aux, uint32_t data);
+
+/**
+ * Allocates an empty tree.
+ *
+ * @param margin the fraction of a box's size that its fattened box extends
+ *   past it on each side
+ * @return the new tree
+ */
+aabb_tree_t *aabb_tree_init(double margin);
+
+/**
+ * Releases the memory allocated for a tree.
+ *
+ * @param tree a pointer returned from aabb_tree_init()
+ */
+void aabb_tree_free(aabb_tree_t *tree);
+
+/**
+ * Gets the number of proxies in a tree.
+ *
+ * @param tree a pointer returned from aabb_tree_init()
+ * @return the number of proxies inserted and not yet removed
+ */
+size_t aabb_tree_size(aabb_tree_t *tree);
+
+/**
+ * Adds a box to a tree.
+ *
+ * @param tree a pointer returned from aabb_tree_init()
+ * @param box the box, which is fattened before it is stored
+ * @param data a value reported when the proxy is found by a query
+ * @return the id of the new proxy, valid until it is removed
+ */
+size_t aabb_tree_insert(aabb_tree_t *tree, aabb_t box, uint32_t data);
+
+/**
+ * Removes a proxy from a tree.
+ *
+ * @param tree a pointer returned from aabb_tree_init()
+ * @param proxy an id returned from aabb_tree_insert()
+ */
+void aabb_tree_remove(aabb_tree_t *tree, size_t proxy);
+
+/**
+ * Updates the box of a proxy.
+ * The tree only changes if the box has left the proxy's fattened box.
+ *
+ * @param tree a pointer returned from aabb_tree_init()
+ * @param proxy an id returned from aabb_tree_insert()
+ * @param box the new box
+ * @return whether the proxy was reinserted with a new fattened box
+ */
+bool aabb_tree_move(aabb_tree_t *tree, size_t proxy, aabb_t box);
+
+/**
+ * Gets the fattened box stored for a proxy.
+ *
+ * @param tree a pointer returned from aabb_tree_init()
+ * @param proxy an id returned from aabb_tree_insert()
+ * @return a box containing the last box given for the proxy
+ */
+aabb_t aabb_tree_get_fat_aabb(aabb_tree_t *tree, size_t proxy);
+
+/**
+ * Calls a function for every proxy whose fattened box overlaps a region.
+ * The function must not insert, remove or move proxies in the same tree.
+ *
+ * @param tree a pointer returned from aabb_tree_init()
+ * @param region the box to search
+ * @param callback the function to call with each proxy's data
+ * @param aux an auxiliary value passed to the callback
+ */
+void aabb_tree_query(aabb_tree_t *tree, aabb_t region,
+                     aabb_tree_query_t callback, void *aux);
+
+#endif // #ifndef __AABB_TREE_H__
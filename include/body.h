@@ -3,17 +3,46 @@
 
 #include "color.h"
 #include "list.h"
+#include "polygon.h"
 #include "vector.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * A rigid body constrained to the plane.
  * Implemented as a polygon with uniform density.
+ * The shape is stored once, relative to the centroid, in a single contiguous
+ * array owned by the body, along with the body's position and rotation.
+ * World-space vertices are only computed when they are requested
+ * (e.g. by body_get_shape_view()) after the body has moved.
  * Bodies can accumulate forces and impulses during each tick.
  * Angular physics (i.e. torques) are not currently implemented.
  */
 typedef struct body body_t;
 
+/**
+ * A structure-of-arrays store for the kinematic state of many bodies:
+ * parallel arrays of centroids, velocities, forces, impulses and masses.
+ * Scenes keep their bodies in a pool so integration walks dense arrays.
+ * While a body is in a pool, its body_t acts as a handle to its pool entry;
+ * all body_*() functions keep working on it as before.
+ */
+typedef struct body_pool body_pool_t;
+
+/**
+ * A generational reference to a body in a body pool.
+ * Unlike a body_t*, a handle can be checked for validity after the body is
+ * removed: removing a body bumps its slot's generation, so every handle to it
+ * stops resolving in constant time, even once the slot is reused.
+ */
+typedef struct {
+  /** The index of the body's slot in the pool */
+  uint32_t index;
+  /** The generation of the slot when the handle was created, which is never
+   * 0 for a valid handle */
+  uint32_t generation;
+} body_handle_t;
+
 /**
  * Initializes a body without any info.
  * Acts like body_init_with_info() where info and info_freer are NULL.
@@ -25,7 +54,8 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color);
  * The body is initially at rest.
  * Asserts that the mass is positive and that the required memory is allocated.
  *
- * @param shape a list of vectors describing the initial shape of the body
+ * @param shape a list of vectors describing the initial shape of the body.
+ *   The vertices are copied into the body and the list is freed.
  * @param mass the mass of the body (if INFINITY, stops the body from moving)
  * @param color the color of the body, used to draw it on the screen
  * @param info additional information to associate with the body,
@@ -37,8 +67,64 @@ body_t *body_init_with_info(
     list_t *shape, double mass, rgb_color_t color,
     void *info, free_func_t info_freer);
 
+/**
+ * Allocates memory for a body whose shape is given as an array of vertices.
+ * The vertices are copied into the body, so the caller keeps ownership of
+ * the array.
+ * Otherwise acts like body_init_with_info().
+ *
+ * @param points the vertices of the body's initial shape
+ * @param n_points the number of vertices in points
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_from_array_with_info(const vector_t *points, size_t n_points,
+                                       double mass, rgb_color_t color,
+                                       void *info, free_func_t info_freer);
+
+/**
+ * Initializes a body from an array of vertices without any info.
+ * Acts like body_init_from_array_with_info() where info and info_freer
+ * are NULL.
+ */
+body_t *body_init_from_array(const vector_t *points, size_t n_points,
+                             double mass, rgb_color_t color);
+
+/**
+ * Allocates memory for a circular body.
+ * The body collides as an exact circle, but its shape (see body_get_shape())
+ * is a regular polygon inscribed in the circle, so it can still be drawn.
+ * Otherwise acts like body_init_with_info().
+ *
+ * @param center the center of the circle, which is the body's centroid
+ * @param radius the radius of the circle (must be positive)
+ * @param n_points the number of vertices in the polygon used to draw it
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_circle_with_info(vector_t center, double radius,
+                                   size_t n_points, double mass,
+                                   rgb_color_t color, void *info,
+                                   free_func_t info_freer);
+
+/**
+ * Initializes a circular body without any info.
+ * Acts like body_init_circle_with_info() where info and info_freer are NULL.
+ */
+body_t *body_init_circle(vector_t center, double radius, size_t n_points,
+                         double mass, rgb_color_t color);
+
 /**
  * Releases the memory allocated for a body.
+ * Asserts that the body is not in a body pool. If it was only given a handle
+ * (see body_pool_reserve_handle()), its slot is released and the handle
+ * becomes invalid.
  *
  * @param body a pointer to a body returned from body_init()
  */
@@ -53,11 +139,48 @@ void body_free(void *body);
  */
 list_t *body_get_shape(body_t *body);
 
+/**
+ * Gets a read-only view of the current shape of a body without copying it.
+ * If the body has moved since its world-space vertices were last computed,
+ * they are recomputed first. The view includes the body's edge normals,
+ * which are cached and only recomputed after the body rotates, and if the
+ * body is convex, its hints for finding extreme vertices.
+ * The view borrows the body's vertices, so it is only valid until the body's
+ * shape next changes (e.g. body_set_centroid(), body_tick()) or it is freed.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return a view of the polygon describing the body's current position
+ */
+shape_view_t body_get_shape_view(body_t *body);
+
+/**
+ * Gets the axis-aligned bounding box of a body's current shape.
+ * The bounds of the rotated shape are cached, so this only costs
+ * a translation unless the body was rotated since the last call.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the smallest box containing the body's vertices,
+ *   or its circle if it is circular
+ */
+aabb_t body_get_aabb(body_t *body);
+
+/**
+ * Gets a counter that changes whenever a body's shape is moved or replaced
+ * explicitly, i.e. by body_set_centroid(), body_set_rotation()
+ * or body_set_points(). Integration in body_tick() does not change it.
+ * Lets callers tell whether geometry they cached earlier in a tick is stale.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's geometry version
+ */
+uint32_t body_get_geometry_version(body_t *body);
+
 /**
  * Gets the current center of mass of a body.
  * While this could be calculated with polygon_centroid(), that becomes too slow
  * when this function is called thousands of times every tick.
- * Instead, the body should store its current centroid.
+ * Instead, the body stores its current centroid, computed when its shape is
+ * set and updated incrementally when it is translated or rotated.
  *
  * @param body a pointer to a body returned from body_init()
  * @return the body's center of mass
@@ -72,6 +195,24 @@ vector_t body_get_centroid(body_t *body);
  */
 vector_t body_get_velocity(body_t *body);
 
+/**
+ * Gets the radius of a circular body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the radius passed to body_init_circle(), or 0 if the body is a
+ *   polygon
+ */
+double body_get_radius(body_t *body);
+
+/**
+ * Returns whether a body's shape is a rectangle. Rectangles are detected
+ * when the shape is set, and collide through a faster path.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is a rectangle
+ */
+bool body_is_box(body_t *body);
+
 /**
  * Gets the mass of a body.
  *
@@ -80,6 +221,25 @@ vector_t body_get_velocity(body_t *body);
  */
 double body_get_mass(body_t *body);
 
+/**
+ * Gets the area of a body's shape.
+ * The area is cached when the shape is set, so this takes constant time.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the area of the polygon describing the body
+ */
+double body_get_area(body_t *body);
+
+/**
+ * Gets the moment of inertia of a body about its center of mass,
+ * assuming the mass is spread uniformly over its shape.
+ * The moment is cached when the shape is set, so this takes constant time.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's moment of inertia (INFINITY if its mass is INFINITY)
+ */
+double body_get_moment(body_t *body);
+
 /**
  * Gets the display color of a body.
  *
@@ -177,16 +337,56 @@ void body_remove(body_t *body);
  */
 bool body_is_removed(body_t *body);
 
+/**
+ * Flags a body as fast-moving, so a scene sweeps its motion over each tick
+ * against the bodies it has collision handlers or contacts with, instead of
+ * only testing where it ends up. A bullet that would pass through one of
+ * them is stopped just inside it, so the collision is seen on the next tick.
+ * Bodies are not bullets by default.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param bullet whether the body is a bullet
+ */
+void body_set_bullet(body_t *body, bool bullet);
+
+/**
+ * Returns whether a body is flagged as a bullet; see body_set_bullet().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is a bullet
+ */
+bool body_is_bullet(body_t *body);
+
 void body_set_force(body_t *body, vector_t force);
 
 vector_t body_get_force(body_t *body);
 
+vector_t body_get_impulse(body_t *body);
+
 double body_get_angle(body_t *body);
 
 void body_set_angle(body_t *body, double angle);
 
+/**
+ * Replaces the shape of a body.
+ * The vertices are copied into the body and the list is freed.
+ * A circular body becomes a polygon.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param points a list of vectors describing the body's new shape
+ */
 void body_set_points(body_t *body, list_t *points);
 
+/**
+ * Replaces the shape of a body with a copy of an array of vertices.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param points the vertices of the body's new shape
+ * @param n_points the number of vertices in points
+ */
+void body_set_points_array(body_t *body, const vector_t *points,
+                           size_t n_points);
+
 bool body_is_player(body_t *body);
 
 void body_reset(body_t *body);
@@ -195,4 +395,106 @@ void body_set_color(body_t *body, rgb_color_t color);
 
 void body_decrease_velocity(body_t *body, double factor);
 
+/**
+ * Allocates memory for an empty body pool.
+ *
+ * @param capacity the number of bodies to allocate space for
+ * @return the new pool
+ */
+body_pool_t *body_pool_init(size_t capacity);
+
+/**
+ * Releases the memory allocated for a body pool.
+ * Any bodies still in the pool are moved out of it first; they are not freed.
+ *
+ * @param pool a pointer to a pool returned from body_pool_init()
+ */
+void body_pool_free(body_pool_t *pool);
+
+/**
+ * Ensures a body pool has space for at least the given number of bodies.
+ *
+ * @param pool a pointer to a pool returned from body_pool_init()
+ * @param capacity the number of bodies to allocate space for
+ */
+void body_pool_reserve(body_pool_t *pool, size_t capacity);
+
+/**
+ * Gets the number of bodies in a body pool.
+ *
+ * @param pool a pointer to a pool returned from body_pool_init()
+ * @return the number of bodies added with body_pool_add() and not removed
+ */
+size_t body_pool_size(body_pool_t *pool);
+
+/**
+ * Gets a handle to a body in a body pool, without changing the pool.
+ *
+ * @param pool a pointer to a pool returned from body_pool_init()
+ * @param body the body to get a handle to
+ * @return a handle that resolves to body until it is removed from the pool,
+ *   or an invalid handle, which never resolves, if body has no slot in the
+ *   pool (see body_pool_reserve_handle())
+ */
+body_handle_t body_pool_get_handle(body_pool_t *pool, body_t *body);
+
+/**
+ * Gets a handle to a body, giving it a slot in a body pool if it has none,
+ * so handles can be taken before body_pool_add() is called. The slot is
+ * released if the body is freed without being added.
+ * Asserts that the body does not belong to a different pool.
+ *
+ * @param pool a pointer to a pool returned from body_pool_init()
+ * @param body the body to get a handle to
+ * @return a handle that resolves to body until it is removed from the pool
+ */
+body_handle_t body_pool_reserve_handle(body_pool_t *pool, body_t *body);
+
+/**
+ * Gets the body a handle refers to.
+ *
+ * @param pool the pool the handle was created from
+ * @param handle a handle returned from body_pool_get_handle()
+ * @return the body, or NULL if it has been removed from the pool or the
+ *   handle is invalid
+ */
+body_t *body_pool_resolve(body_pool_t *pool, body_handle_t handle);
+
+/**
+ * Returns whether a handle still refers to a body in a pool.
+ * Equivalent to body_pool_resolve(pool, handle) != NULL.
+ */
+bool body_handle_is_valid(body_pool_t *pool, body_handle_t handle);
+
+/**
+ * Moves a body's kinematic state into a body pool.
+ * Asserts that the body is not already in a pool.
+ *
+ * @param pool a pointer to a pool returned from body_pool_init()
+ * @param body the body to add
+ */
+void body_pool_add(body_pool_t *pool, body_t *body);
+
+/**
+ * Moves a body's kinematic state out of a body pool and back into the body,
+ * and invalidates all handles to it.
+ * The last body in the pool takes its place, so this takes constant time.
+ * Asserts that the body is in the given pool.
+ *
+ * @param pool a pointer to a pool returned from body_pool_init()
+ * @param body the body to remove
+ */
+void body_pool_remove(body_pool_t *pool, body_t *body);
+
+/**
+ * Calls body_tick() on every body in a body pool,
+ * iterating over the pool's arrays directly.
+ * Uses AVX or SSE2 when the compiler targets them (e.g. -mavx), and a scalar
+ * loop otherwise; every version gives bit-for-bit the same result.
+ *
+ * @param pool a pointer to a pool returned from body_pool_init()
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_pool_tick(body_pool_t *pool, double dt);
+
 #endif // #ifndef __BODY_H__
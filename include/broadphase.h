@@ -0,0 +1,114 @@
+#ifndef __BROADPHASE_H__
+#define __BROADPHASE_H__
+
+#include "body.h"
+#include "list.h"
+#include <stdbool.h>
+
+/**
+ * The algorithms a broadphase can use to find pairs of bodies
+ * whose bounding boxes may overlap.
+ */
+typedef enum {
+  /**
+   * No index; every pair of bodies is tested. A pair manager updates every
+   * pair it has instead of asking for candidates.
+   */
+  BROADPHASE_NONE = 0,
+  /** A uniform grid of cells, hashed by cell coordinates */
+  BROADPHASE_GRID = 1,
+  /**
+   * Sweep-and-prune along the x axis, with the endpoints kept sorted
+   * between ticks. Suits scenes that are spread out horizontally.
+   */
+  BROADPHASE_SAP = 2,
+  /**
+   * Dynamic bounding volume trees with fattened boxes, one for bodies that
+   * cannot move by themselves (infinite mass, at rest, and not moved
+   * explicitly since pairs were last found) and one for the rest.
+   * Pairs of static bodies are never visited, since they cannot have started
+   * overlapping. Also speeds up broadphase_query_region().
+   */
+  BROADPHASE_TREE = 3,
+} broadphase_kind_t;
+
+/**
+ * A per-tick index of which bodies in a scene are close enough to collide.
+ * Bodies are identified by their slots in a body pool.
+ */
+typedef struct broadphase broadphase_t;
+
+/**
+ * A function called with each pair of bodies found by
+ * broadphase_find_pairs().
+ *
+ * @param aux the auxiliary value passed to broadphase_find_pairs()
+ * @param handle1 a handle to one body of the pair
+ * @param handle2 a handle to the other body
+ */
+typedef void (*broadphase_pair_found_t)(void *aux, body_handle_t handle1,
+                                        body_handle_t handle2);
+
+/**
+ * Allocates an empty broadphase over the bodies in a pool.
+ *
+ * @param pool the pool the queried bodies belong to
+ * @param kind the algorithm to use
+ * @return the new broadphase
+ */
+broadphase_t *broadphase_init(body_pool_t *pool, broadphase_kind_t kind);
+
+/**
+ * Releases the memory allocated for a broadphase.
+ *
+ * @param broadphase a pointer returned from broadphase_init()
+ */
+void broadphase_free(broadphase_t *broadphase);
+
+/**
+ * Changes the algorithm used by a broadphase and invalidates it.
+ *
+ * @param broadphase a pointer returned from broadphase_init()
+ * @param kind the algorithm to use
+ */
+void broadphase_set_kind(broadphase_t *broadphase, broadphase_kind_t kind);
+
+broadphase_kind_t broadphase_get_kind(broadphase_t *broadphase);
+
+/**
+ * Marks a broadphase out of date, e.g. after the bodies have been integrated.
+ * The next broadphase_query_region() rebuilds it.
+ *
+ * @param broadphase a pointer returned from broadphase_init()
+ */
+void broadphase_invalidate(broadphase_t *broadphase);
+
+/**
+ * Rebuilds a broadphase from the current bounding boxes of the bodies and
+ * reports every pair of them whose boxes overlap, each once, in no
+ * particular order. Pairs of static bodies are skipped by BROADPHASE_TREE.
+ * The callback must not move, add or remove bodies.
+ *
+ * @param broadphase a pointer returned from broadphase_init()
+ * @param bodies the list of every body the broadphase should index
+ * @param found the function to call with each pair
+ * @param aux an auxiliary value to pass to found
+ */
+void broadphase_find_pairs(broadphase_t *broadphase, list_t *bodies,
+                           broadphase_pair_found_t found, void *aux);
+
+/**
+ * Finds the bodies whose bounding boxes overlap a region.
+ * With BROADPHASE_TREE this searches the trees as of the most recent build
+ * (rebuilding first if it is out of date), so a body moved explicitly far
+ * from its position at the build may be missed. Other kinds test every body.
+ *
+ * @param broadphase a pointer returned from broadphase_init()
+ * @param bodies the list of every body the broadphase should index
+ * @param region the box to search
+ * @param result the list to add the bodies found to
+ */
+void broadphase_query_region(broadphase_t *broadphase, list_t *bodies,
+                             aabb_t region, list_t *result);
+
+#endif // #ifndef __BROADPHASE_H__
@@ -2,12 +2,14 @@
 #define __COLLISION_H__
 
 #include "list.h"
+#include "polygon.h"
 #include "vector.h"
 #include <stdbool.h>
 
 /**
  * Represents the status of a collision between two shapes.
  * The shapes are either not colliding, or they are colliding along some axis.
+ * If collided is false, every other field is undefined.
  */
 typedef struct {
   /** Whether the two shapes are colliding */
@@ -16,15 +18,34 @@ typedef struct {
    * If the shapes are colliding, the axis they are colliding on.
    * This is a unit vector pointing from the first shape towards the second.
    * Normal impulses are applied along this axis.
-   * If collided is false, this value is undefined.
    */
   vector_t axis;
+  /**
+   * How far the second shape must move along axis (or the first shape
+   * against it) for the shapes to stop overlapping
+   */
+  double depth;
+  /** The number of points in contacts, 1 or 2 if the shapes are colliding */
+  size_t n_contacts;
+  /**
+   * Where the shapes touch: points of one shape that lie inside the other.
+   * Two points are found when edges of the shapes overlap.
+   */
+  vector_t contacts[2];
 } collision_info_t;
 
+/**
+ * Returns whether two axis-aligned boxes overlap or touch.
+ * Shapes whose boxes do not overlap can never collide.
+ */
+bool aabb_overlaps(aabb_t box1, aabb_t box2);
+
 bool collision_get_collided(collision_info_t collision);
 
 vector_t collision_get_axis(collision_info_t collision);
 
+double collision_get_depth(collision_info_t collision);
+
 /**
  * Computes the status of the collision between two convex polygons.
  * The shapes are given as lists of vertices in counterclockwise order.
@@ -33,9 +54,41 @@ vector_t collision_get_axis(collision_info_t collision);
  *
  * @param shape1 the first shape
  * @param shape2 the second shape
- * @return whether the shapes are colliding, and if so, the collision axis.
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * penetration depth and contact points.
  * The axis should be a unit vector pointing from shape1 towards shape2.
  */
 collision_info_t find_collision(list_t *shape1, list_t *shape2);
 
+/**
+ * Computes the status of the collision between two convex polygons
+ * given as borrowed vertex views, e.g. from body_get_shape_view().
+ * Behaves exactly like find_collision() but never copies the vertices.
+ * Views of circles (with a positive radius) are tested as exact circles
+ * in constant time against each other, and against a polygon's edge normals
+ * and closest vertex.
+ * Rectangles (with positive half_extents) are projected from their centers
+ * and tested along only two of their edge normals.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * penetration depth and contact points.
+ */
+collision_info_t find_collision_view(shape_view_t shape1, shape_view_t shape2);
+
+/**
+ * Finds when a shape moving in a straight line first overlapped another,
+ * stationary shape. Polygons are swept along their edge normals, and a
+ * circle's center is swept against the other shape grown by its radius.
+ *
+ * @param shape1 the moving shape, at the end of its motion
+ * @param displacement how far shape1 moved
+ * @param shape2 the stationary shape
+ * @return the fraction of the motion, from 0 to 1, after which the shapes
+ *   overlap, or INFINITY if they never overlap during it
+ */
+double find_time_of_impact(shape_view_t shape1, vector_t displacement,
+                           shape_view_t shape2);
+
 #endif // #ifndef __COLLISION_H__
@@ -66,6 +66,8 @@ void create_drag(scene_t *scene, double gamma, body_t *body);
  * allowing different things to happen on a collision.
  * The handler is passed the bodies, the collision axis, and an auxiliary value.
  * It should only be called once while the bodies are still colliding.
+ * The handler is registered with scene_add_collision_handler(), so it shares
+ * one collision test per tick with every other handler on the same bodies.
  *
  * @param scene the scene containing the bodies
  * @param body1 the first body
@@ -91,15 +93,11 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
 void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2);
 
 /**
- * Adds a force creator to a scene that applies impulses
- * to resolve collisions between two bodies in the scene.
- * This should be represented as an on-collision callback
- * registered with create_collision().
- *
- * You may remember from project01 that you should avoid applying impulses
- * multiple times while the bodies are still colliding.
- * You should also have a special case that allows either body1 or body2
- * to have mass INFINITY, as this is useful for simulating walls.
+ * Makes a scene resolve collisions between two bodies in the scene
+ * with impulses, using the scene's contact solver
+ * (see scene_set_collision_solid()).
+ * Either body1 or body2 may have mass INFINITY, which is useful for
+ * simulating walls.
  *
  * @param scene the scene containing the bodies
  * @param elasticity the "coefficient of restitution" of the collision;
@@ -0,0 +1,53 @@
+#ifndef __GJK_H__
+#define __GJK_H__
+
+#include "polygon.h"
+#include "vector.h"
+
+/**
+ * The outcome of testing two convex shapes with gjk_find_axis().
+ */
+typedef enum {
+  /** The shapes are apart, or only touch */
+  GJK_SEPARATED = 0,
+  /** The shapes overlap, and the axis of least penetration was found */
+  GJK_OVERLAPPING = 1,
+  /**
+   * The shapes are too flat or too close to touching for a reliable answer,
+   * or their axis of least penetration took too many steps to find,
+   * so they should be tested another way
+   */
+  GJK_DEGENERATE = 2,
+} gjk_result_t;
+
+/**
+ * Gets the point of a shape farthest along a direction.
+ * Circles and rectangles are answered in constant time; other polygons
+ * are searched with polygon_find_extreme().
+ *
+ * @param shape a view of a circle or convex polygon
+ * @param direction the direction to search along, which need not be a unit
+ *   vector but must not be zero
+ * @return a point of the shape with the largest projection onto direction
+ */
+vector_t gjk_support(shape_view_t shape, vector_t direction);
+
+/**
+ * Tests two convex shapes for overlap with the Gilbert-Johnson-Keerthi
+ * algorithm, and if they overlap, finds the axis along which they penetrate
+ * least with the expanding polytope algorithm.
+ * Both work on the Minkowski difference of the shapes through gjk_support()
+ * alone, so each step is linear in the number of vertices at worst,
+ * rather than projecting every vertex onto every edge normal.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @param axis where to store the unit axis of least penetration if the
+ *   shapes overlap, pointing either way between them
+ * @return whether the shapes overlap, or GJK_DEGENERATE if the test could
+ *   not tell
+ */
+gjk_result_t gjk_find_axis(shape_view_t shape1, shape_view_t shape2,
+                           vector_t *axis);
+
+#endif // #ifndef __GJK_H__
@@ -17,6 +17,12 @@ typedef struct list list_t;
  */
 typedef void (*free_func_t)(void *);
 
+/**
+ * A function that decides whether list_remove_if() should remove an element.
+ * Takes in the element and an auxiliary value passed to list_remove_if().
+ */
+typedef bool (*list_predicate_t)(void *item, void *aux);
+
 /**
  * Allocates memory for a new list with space for the given number of elements.
  * The list is initially empty.
@@ -65,6 +71,57 @@ void *list_get(list_t *list, size_t index);
  */
 void *list_remove(list_t *list, size_t index);
 
+/**
+ * Removes the element at a given index in a list and returns it,
+ * moving the last element into its place.
+ * Takes constant time, but does not preserve the order of the list.
+ * Asserts that the index is valid, given the list's current size.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param index an index in the list (the first element is at 0)
+ * @return the element at the given index in the list
+ */
+void *list_swap_remove(list_t *list, size_t index);
+
+/**
+ * Removes every element matching a predicate in a single pass,
+ * keeping the remaining elements in order.
+ * Removed elements are passed to the list's freer, if it has one.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param predicate returns true for the elements to remove
+ * @param aux an auxiliary value to pass to predicate
+ * @return the number of elements removed
+ */
+size_t list_remove_if(list_t *list, list_predicate_t predicate, void *aux);
+
+/**
+ * Removes all elements from a list, passing them to the list's freer
+ * if it has one. The list keeps its capacity.
+ *
+ * @param list a pointer to a list returned from list_init()
+ */
+void list_clear(list_t *list);
+
+/**
+ * Grows a list's capacity to hold at least the given number of elements.
+ * Asserts that the resize succeeded.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param capacity the number of elements to make space for
+ */
+void list_reserve(list_t *list, size_t capacity);
+
+/**
+ * Appends an array of elements to the end of a list, resizing at most once.
+ * Asserts that none of the values are NULL.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param items the elements to add, in order
+ * @param n_items the number of elements in items
+ */
+void list_append_array(list_t *list, void *const *items, size_t n_items);
+
 /**
  * Appends an element to the end of a list.
  * If the list is filled to capacity, resizes the list to fit more elements
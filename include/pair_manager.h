@@ -0,0 +1,218 @@
+#ifndef __PAIR_MANAGER_H__
+#define __PAIR_MANAGER_H__
+
+#include "body.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "list.h"
+#include "vector.h"
+#include <stdbool.h>
+
+/**
+ * A function called when two bodies in a pair are colliding.
+ * Has the same signature as collision_handler_t in forces.h.
+ *
+ * @param body1 the first body the handler was registered with
+ * @param body2 the second body the handler was registered with
+ * @param axis a unit vector pointing from body1 towards body2
+ * @param aux the auxiliary value the handler was registered with
+ */
+typedef void (*pair_handler_t)(body_t *body1, body_t *body2, vector_t axis,
+                               void *aux);
+
+/**
+ * The contact state of a pair of bodies after its most recent update.
+ */
+typedef enum {
+  /** The bodies are not colliding, and were not on the update before */
+  PAIR_SEPARATED = 0,
+  /** The bodies started colliding on this update */
+  PAIR_BEGIN = 1,
+  /** The bodies were already colliding and still are */
+  PAIR_PERSIST = 2,
+  /** The bodies stopped colliding on this update */
+  PAIR_END = 3,
+} pair_state_t;
+
+/**
+ * A table of the pairs of bodies in a scene that have collision handlers or
+ * are solid to each other, keyed by the pair of body handles. Each update
+ * pass tests the pairs the broadphase finds close enough to collide, tracks
+ * whether their bodies are colliding across updates, and dispatches every
+ * handler registered on them.
+ * The manager also memoizes the narrowphase result of every pair of bodies
+ * tested during a tick, so each distinct pair is tested at most once per tick
+ * unless one of its bodies is moved explicitly.
+ */
+typedef struct pair_manager pair_manager_t;
+
+/**
+ * Allocates an empty pair manager for the bodies of a scene.
+ * The pool, broadphase and list are borrowed and must outlive the manager.
+ *
+ * @param pool the pool the bodies belong to
+ * @param broadphase the broadphase that finds the pairs to update
+ * @param bodies the list of every body the broadphase indexes
+ * @return the new pair manager
+ */
+pair_manager_t *pair_manager_init(body_pool_t *pool, broadphase_t *broadphase,
+                                  list_t *bodies);
+
+/**
+ * Releases the memory allocated for a pair manager and the pairs still in
+ * it, with the auxiliary values of their handlers.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ */
+void pair_manager_free(pair_manager_t *manager);
+
+/**
+ * Gets the number of pairs in a pair manager.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ * @return the number of pairs added and not yet freed
+ */
+size_t pair_manager_size(pair_manager_t *manager);
+
+/**
+ * Registers a handler on the pair of two bodies, adding the pair if needed.
+ * Handlers of a pair run in the order they were registered, each with the
+ * bodies in the order it was registered with. The pair is freed when either
+ * body is removed (see pair_manager_remove_body()).
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler the function to call when the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ * @param persistent if true, the handler is called on every update while the
+ *   bodies are colliding; otherwise only when they start colliding
+ */
+void pair_manager_add_handler(pair_manager_t *manager, body_t *body1,
+                              body_t *body2, pair_handler_t handler, void *aux,
+                              free_func_t freer, bool persistent);
+
+/**
+ * Marks the pair of two bodies as solid, adding the pair if needed, so while
+ * they overlap, their contacts are collected for
+ * pair_manager_solve_contacts() and pair_manager_correct_positions().
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the coefficient of restitution of the contact;
+ *   0 is perfectly inelastic and 1 is perfectly elastic
+ */
+void pair_manager_set_solid(pair_manager_t *manager, body_t *body1,
+                            body_t *body2, double elasticity);
+
+/**
+ * Updates the pairs whose bodies may be colliding: the pairs the broadphase
+ * finds with overlapping bounding boxes (see broadphase_find_pairs()), and
+ * the pairs the last update left colliding, so they see the collision end.
+ * Each is tested once, advances its contact state, and calls its handlers,
+ * in the order the pairs were added. Every other pair stays PAIR_SEPARATED
+ * at no cost. With BROADPHASE_NONE, every pair is updated.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ */
+void pair_manager_update(pair_manager_t *manager);
+
+/**
+ * Frees every pair of a body, e.g. when it is removed from its pool.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ * @param handle a handle to the body
+ */
+void pair_manager_remove_body(pair_manager_t *manager, body_handle_t handle);
+
+/**
+ * Applies impulses that stop the bodies of every solid pair found overlapping
+ * by the updates since the last call from approaching each other.
+ * All the contacts are solved together by sequential impulses: each
+ * iteration visits every contact in turn, adjusting its accumulated impulse
+ * so the bodies separate at the speed their elasticity asks for, without the
+ * total ever pulling them together. Contacts that persisted since the last
+ * call start from the impulse they ended it with.
+ * Call before body_tick(), since the impulses are added to the bodies.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ * @param dt the length of the tick, to predict the effect of the forces
+ *   applied so far
+ * @param iterations the number of passes over the contacts
+ */
+void pair_manager_solve_contacts(pair_manager_t *manager, double dt,
+                                 size_t iterations);
+
+/**
+ * Pushes apart the bodies of every solid pair found overlapping by the
+ * updates since the last call, then forgets those contacts.
+ * Each pair is moved along its collision axis by a fraction of its
+ * penetration depth beyond a small allowance, split between the bodies in
+ * proportion to their inverse masses. Leaving a little overlap keeps resting
+ * bodies in contact, so their handlers see one continuous collision.
+ * Call after pair_manager_solve_contacts(), which shares the contacts.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ */
+void pair_manager_correct_positions(pair_manager_t *manager);
+
+/**
+ * Records where every body starts a tick, noting the bullet bodies
+ * (see body_set_bullet()), for pair_manager_sweep_bullets().
+ * Call just before integrating the bodies.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ */
+void pair_manager_save_bullets(pair_manager_t *manager);
+
+/**
+ * Sweeps the motion of every bullet saved by pair_manager_save_bullets()
+ * against each body it has a pair with, relative to that body's motion
+ * over the tick (see find_time_of_impact()). A bullet that passed into such
+ * a body without ending inside it is moved back along its relative motion to
+ * just inside the first one it hit, keeping its velocity, so the collision is
+ * handled on the next update. Two bullets that hit each other first are both
+ * moved back to where they met. Call just after integrating the bodies.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ */
+void pair_manager_sweep_bullets(pair_manager_t *manager);
+
+/**
+ * Tests two bodies for a collision, reusing the result of an earlier test of
+ * the same pair (in either order) in the same tick if neither body's
+ * geometry version has changed since (see body_get_geometry_version()).
+ * Bodies whose bounding boxes are apart are not colliding. Results for
+ * bodies that are not in the manager's pool are not memoized.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the bodies are colliding, and if so, the collision axis,
+ *   pointing from body1 towards body2
+ */
+collision_info_t pair_manager_find_collision(pair_manager_t *manager,
+                                             body_t *body1, body_t *body2);
+
+/**
+ * Forgets every memoized narrowphase result, e.g. after the bodies have
+ * been integrated.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ */
+void pair_manager_next_tick(pair_manager_t *manager);
+
+/**
+ * Gets the contact state of two bodies as of their pair's last update.
+ *
+ * @param manager a pointer returned from pair_manager_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return the state of the pair, or PAIR_SEPARATED if the bodies have no pair
+ */
+pair_state_t pair_manager_get_state(pair_manager_t *manager, body_t *body1,
+                                    body_t *body2);
+
+#endif // #ifndef __PAIR_MANAGER_H__
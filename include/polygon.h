@@ -4,9 +4,63 @@
 #include "color.h"
 #include "list.h"
 #include "vector.h"
+#include <stdbool.h>
 
 typedef struct polygon polygon_t;
 
+/**
+ * The number of ranges of directions a shape view keeps a starting vertex for
+ * in extreme_hints (see polygon_find_extreme()).
+ */
+#define POLYGON_EXTREME_HINTS 16
+
+/**
+ * A read-only view of a polygon whose vertices are stored contiguously.
+ * The view borrows the vertices; it does not own or copy them.
+ */
+typedef struct {
+  /** The vertices of the polygon, in counterclockwise order */
+  const vector_t *points;
+  /** The number of vertices in points */
+  size_t size;
+  /**
+   * The unit normal of the edge from each vertex to the next
+   * (see polygon_edge_normal()), or NULL to compute them from the vertices
+   */
+  const vector_t *normals;
+  /**
+   * If positive, the shape is the circle of this radius around center,
+   * and points only approximate it (e.g. for drawing)
+   */
+  double radius;
+  /** The center of the circle or rectangle, if the shape is one */
+  vector_t center;
+  /**
+   * If x is positive, the polygon is a rectangle around center, and these
+   * are its half-widths along normals[0] (x) and normals[1] (y)
+   */
+  vector_t half_extents;
+  /**
+   * If non-NULL, the polygon is strictly convex (see
+   * polygon_is_convex_array()), and this is an array of
+   * POLYGON_EXTREME_HINTS vertex indices where polygon_find_extreme() starts
+   * searching, one per range of directions. Unlike the rest of the view, it is
+   * updated by each search, so the owner of the vertices should keep it
+   * between calls.
+   */
+  size_t *extreme_hints;
+} shape_view_t;
+
+/**
+ * An axis-aligned bounding box.
+ */
+typedef struct {
+  /** The corner with the smallest x and y coordinates */
+  vector_t min;
+  /** The corner with the largest x and y coordinates */
+  vector_t max;
+} aabb_t;
+
 polygon_t *polygon_init(size_t n_points, rgb_color_t color);
 
 /**
@@ -31,6 +85,107 @@ double polygon_area(list_t *polygon);
  */
 vector_t polygon_centroid(list_t *polygon);
 
+/**
+ * Computes the area of a polygon stored as a contiguous array of vertices.
+ * Behaves exactly like polygon_area().
+ *
+ * @param points the vertices of the polygon, in counterclockwise order
+ * @param size the number of vertices in points
+ * @return the area of the polygon
+ */
+double polygon_area_array(const vector_t *points, size_t size);
+
+/**
+ * Computes the center of mass of a polygon stored as a contiguous array
+ * of vertices. Behaves exactly like polygon_centroid().
+ *
+ * @param points the vertices of the polygon, in counterclockwise order
+ * @param size the number of vertices in points
+ * @return the centroid of the polygon
+ */
+vector_t polygon_centroid_array(const vector_t *points, size_t size);
+
+/**
+ * Computes the second moment of area of a polygon about a given point,
+ * i.e. the moment of inertia of the polygon with unit density.
+ * See https://en.wikipedia.org/wiki/Second_moment_of_area#Any_polygon.
+ *
+ * @param points the vertices of the polygon, in counterclockwise order
+ * @param size the number of vertices in points
+ * @param point the point to compute the moment about (usually the centroid)
+ * @return the polar second moment of area of the polygon about point
+ */
+double polygon_moment_array(const vector_t *points, size_t size,
+                            vector_t point);
+
+/**
+ * Computes the smallest axis-aligned box containing a polygon.
+ *
+ * @param points the vertices of the polygon
+ * @param size the number of vertices in points (must be positive)
+ * @return the bounding box of the polygon
+ */
+aabb_t polygon_aabb_array(const vector_t *points, size_t size);
+
+/**
+ * Computes the unit normal of a polygon edge: the edge direction turned
+ * a quarter turn counterclockwise. The separating axis test only needs the
+ * normal's direction up to sign.
+ *
+ * @param point1 the vertex the edge starts at
+ * @param point2 the vertex the edge ends at
+ * @return the edge's unit normal
+ */
+vector_t polygon_edge_normal(vector_t point1, vector_t point2);
+
+/**
+ * Computes the unit normal of every edge of a polygon.
+ *
+ * @param points the vertices of the polygon, in counterclockwise order
+ * @param size the number of vertices in points
+ * @param normals an array of size vectors to store the normal of the edge
+ *   from each vertex to the next in
+ */
+void polygon_edge_normals_array(const vector_t *points, size_t size,
+                                vector_t *normals);
+
+/**
+ * Determines whether a polygon is a rectangle: it has 4 vertices,
+ * its opposite edges are equal and its adjacent edges are perpendicular,
+ * up to rounding error.
+ *
+ * @param points the vertices of the polygon
+ * @param size the number of vertices in points
+ * @return whether the polygon is a rectangle
+ */
+bool polygon_is_rectangle_array(const vector_t *points, size_t size);
+
+/**
+ * Determines whether a polygon is strictly convex: it turns the same way at
+ * every vertex, by more than rounding error, and winds around once.
+ * Repeated vertices and vertices where it goes straight on are not allowed,
+ * since the projections of their neighbours along some direction tie.
+ *
+ * @param points the vertices of the polygon
+ * @param size the number of vertices in points
+ * @return whether the polygon is convex
+ */
+bool polygon_is_convex_array(const vector_t *points, size_t size);
+
+/**
+ * Finds the vertex of a polygon farthest along a direction.
+ * If the view has extreme_hints, climbs from vertex to neighbouring vertex,
+ * starting from the answer last found for a nearby direction, which takes a
+ * few steps when the shapes and axes move little between calls.
+ * Otherwise visits every vertex.
+ *
+ * @param shape a view of a polygon
+ * @param direction the direction to search along, which must not be zero
+ * @return the index in shape.points of a vertex with the largest projection
+ *   onto direction
+ */
+size_t polygon_find_extreme(shape_view_t shape, vector_t direction);
+
 vector_t vec_rotate_point(vector_t v, double angle, vector_t point);
 
 /**
@@ -53,6 +208,31 @@ void polygon_translate(list_t *polygon, vector_t translation);
  */
 void polygon_rotate(list_t *polygon, double angle, vector_t point);
 
+/**
+ * Translates all vertices in a contiguous vertex array by a given vector.
+ * Note: mutates the original array.
+ *
+ * @param points the vertices of the polygon
+ * @param size the number of vertices in points
+ * @param translation the vector to add to each vertex's position
+ */
+void polygon_translate_array(vector_t *points, size_t size,
+                             vector_t translation);
+
+/**
+ * Rotates all vertices in a contiguous vertex array by a given angle
+ * about a given point.
+ * Note: mutates the original array.
+ *
+ * @param points the vertices of the polygon
+ * @param size the number of vertices in points
+ * @param angle the angle to rotate the polygon, in radians.
+ * A positive angle means counterclockwise.
+ * @param point the point to rotate around
+ */
+void polygon_rotate_array(vector_t *points, size_t size, double angle,
+                          vector_t point);
+
 list_t *make_initial_star(size_t n_points);
 
 vector_t *get_velocity(polygon_t *polygon);
@@ -2,7 +2,9 @@
 #define __SCENE_H__
 
 #include "body.h"
+#include "broadphase.h"
 #include "list.h"
+#include "pair_manager.h"
 
 /**
  * A collection of bodies and force creators.
@@ -61,6 +63,137 @@ body_t *scene_get_body(scene_t *scene, size_t index);
  */
 void scene_add_body(scene_t *scene, body_t *body);
 
+/**
+ * Gets a generational handle to a body in a scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body a pointer to the body
+ * @return a handle that resolves to body until it is removed from the scene,
+ *   or an invalid handle if the body has not been added or reserved a handle
+ *   (see body_pool_get_handle())
+ */
+body_handle_t scene_get_body_handle(scene_t *scene, body_t *body);
+
+/**
+ * Gets a generational handle to a body for something that refers to it,
+ * such as a force creator, which may be registered before the body is added
+ * with scene_add_body() (see body_pool_reserve_handle()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body a pointer to the body
+ * @return a handle that resolves to body once it is added, until it is
+ *   removed from the scene
+ */
+body_handle_t scene_reserve_body_handle(scene_t *scene, body_t *body);
+
+/**
+ * Gets the body a handle refers to.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param handle a handle returned from scene_get_body_handle()
+ * @return the body, or NULL if it has been removed from the scene
+ */
+body_t *scene_resolve_body(scene_t *scene, body_handle_t handle);
+
+/**
+ * Selects the broadphase algorithm a scene uses to find which of its pairs of
+ * bodies with collision handlers or contacts are close enough to test, so
+ * pairs that are far apart cost nothing. Scenes use BROADPHASE_GRID by
+ * default.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param kind the broadphase algorithm, or BROADPHASE_NONE to test every pair
+ */
+void scene_set_broadphase(scene_t *scene, broadphase_kind_t kind);
+
+/**
+ * Computes the status of the collision between two bodies in a scene.
+ * Repeated queries on the same pair in a tick share a single narrowphase test
+ * unless either body is moved explicitly in between
+ * (see pair_manager_find_collision()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the bodies are colliding, and if so, the collision axis,
+ *   pointing from body1 towards body2
+ */
+collision_info_t scene_find_collision(scene_t *scene, body_t *body1,
+                                      body_t *body2);
+
+/**
+ * Finds the bodies in a scene whose bounding boxes overlap a region,
+ * using the scene's broadphase (see broadphase_query_region()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param region the box to search
+ * @return a new list of the bodies found, which does not own them
+ */
+list_t *scene_query_region(scene_t *scene, aabb_t region);
+
+/**
+ * Registers a function to call when two bodies in a scene collide.
+ * Each tick, after running its force creators, the scene tests the pairs of
+ * bodies with handlers whose bounding boxes its broadphase finds overlapping,
+ * and runs their handlers in the order the pairs were first registered
+ * (see pair_manager_update()). All handlers on the same two bodies share one
+ * collision test per tick. The pair is removed when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body passed to the handler
+ * @param body2 the second body passed to the handler
+ * @param handler the function to call
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ * @param persistent if true, the handler is called on every tick the bodies
+ *   are colliding; otherwise only on the tick they start colliding
+ */
+void scene_add_collision_handler(scene_t *scene, body_t *body1, body_t *body2,
+                                 pair_handler_t handler, void *aux,
+                                 free_func_t freer, bool persistent);
+
+/**
+ * Makes two bodies in a scene solid to each other. Each tick, after running
+ * its force creators and collision handlers, the scene solves the contacts
+ * of all solid bodies that overlap together, so they stop approaching each
+ * other and bounce back with
+ * the given elasticity (see pair_manager_solve_contacts()), and then pushes
+ * them apart so resting contacts do not sink into each other
+ * (see pair_manager_correct_positions()).
+ * Calling this again on the same bodies replaces their elasticity.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the coefficient of restitution of the contact;
+ *   0 is perfectly inelastic and 1 is perfectly elastic
+ */
+void scene_set_collision_solid(scene_t *scene, body_t *body1, body_t *body2,
+                               double elasticity);
+
+/**
+ * Sets how many passes the scene's contact solver makes over the contacts
+ * each tick. More passes settle stacks and piles of bodies more accurately.
+ * Defaults to 8.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of passes
+ */
+void scene_set_solver_iterations(scene_t *scene, size_t iterations);
+
+/**
+ * Gets whether two bodies in a scene began, kept or stopped colliding
+ * on the last tick their collision handlers ran.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return the contact state, or PAIR_SEPARATED if the bodies have no
+ *   collision handlers
+ */
+pair_state_t scene_get_collision_state(scene_t *scene, body_t *body1,
+                                       body_t *body2);
+
 /**
  * @deprecated Use body_remove() instead
  *
@@ -85,6 +218,7 @@ void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux,
  * The auxiliary value is passed to the force creator each time it is called.
  * The force creator is registered with a list of bodies it applies to,
  * so it can be removed when any one of the bodies is removed.
+ * The scene keeps handles to the bodies and frees the list itself.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param forcer a force creator function
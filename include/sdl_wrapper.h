@@ -4,6 +4,7 @@
 #include "body.h"
 #include "color.h"
 #include "list.h"
+#include "polygon.h"
 #include "scene.h"
 #include "state.h"
 #include "vector.h"
@@ -76,6 +77,16 @@ void sdl_clear(void);
  */
 void sdl_draw_polygon(list_t *points, rgb_color_t color);
 
+/**
+ * Draws a polygon from a borrowed view of its vertices and a color.
+ * Unlike sdl_draw_polygon(), the vertices do not need to be copied into a list,
+ * so this can be passed body_get_shape_view() directly.
+ *
+ * @param shape a view of the vertices of the polygon
+ * @param color the color used to fill in the polygon
+ */
+void sdl_draw_shape(shape_view_t shape, rgb_color_t color);
+
 /**
  * Displays the rendered frame on the SDL window.
  * Must be called after drawing the polygons in order to show them.
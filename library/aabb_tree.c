@@ -0,0 +1,334 @@
+#include "aabb_tree.h"
+#include "collision.h"
+#include "polygon.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Marks a missing parent, child or free node
+const size_t AABB_TREE_NULL = SIZE_MAX;
+const size_t AABB_TREE_INITIAL_CAPACITY = 16;
+
+typedef struct aabb_tree_node {
+  aabb_t box;
+  // The next free node, if the node is free
+  size_t parent;
+  size_t child1;
+  size_t child2;
+  // 0 for leaves, -1 for free nodes
+  int height;
+  uint32_t data;
+} aabb_tree_node_t;
+
+typedef struct aabb_tree {
+  aabb_tree_node_t *nodes;
+  size_t capacity;
+  size_t root;
+  size_t free_list;
+  size_t n_leaves;
+  double margin;
+  // Reused by queries as an explicit traversal stack
+  size_t *stack;
+  size_t stack_capacity;
+} aabb_tree_t;
+
+/**
+ * Threads the nodes from start up to the capacity onto the free list.
+ */
+void aabb_tree_link_free(aabb_tree_t *tree, size_t start) {
+  for (size_t i = start; i < tree->capacity; i++) {
+    tree->nodes[i].parent = i + 1 < tree->capacity ? i + 1 : AABB_TREE_NULL;
+    tree->nodes[i].height = -1;
+  }
+  tree->free_list = start;
+}
+
+aabb_tree_t *aabb_tree_init(double margin) {
+  aabb_tree_t *result = malloc(sizeof(aabb_tree_t));
+  assert(result);
+  result->capacity = AABB_TREE_INITIAL_CAPACITY;
+  result->nodes = malloc(sizeof(aabb_tree_node_t) * result->capacity);
+  assert(result->nodes);
+  aabb_tree_link_free(result, 0);
+  result->root = AABB_TREE_NULL;
+  result->n_leaves = 0;
+  result->margin = margin;
+  result->stack = NULL;
+  result->stack_capacity = 0;
+  return result;
+}
+
+void aabb_tree_free(aabb_tree_t *tree) {
+  free(tree->nodes);
+  free(tree->stack);
+  free(tree);
+}
+
+size_t aabb_tree_size(aabb_tree_t *tree) { return tree->n_leaves; }
+
+size_t aabb_tree_allocate_node(aabb_tree_t *tree) {
+  if (tree->free_list == AABB_TREE_NULL) {
+    size_t old_capacity = tree->capacity;
+    tree->capacity *= 2;
+    tree->nodes =
+        realloc(tree->nodes, sizeof(aabb_tree_node_t) * tree->capacity);
+    assert(tree->nodes);
+    aabb_tree_link_free(tree, old_capacity);
+  }
+  size_t node = tree->free_list;
+  tree->free_list = tree->nodes[node].parent;
+  tree->nodes[node].parent = AABB_TREE_NULL;
+  tree->nodes[node].child1 = AABB_TREE_NULL;
+  tree->nodes[node].child2 = AABB_TREE_NULL;
+  tree->nodes[node].height = 0;
+  return node;
+}
+
+void aabb_tree_free_node(aabb_tree_t *tree, size_t node) {
+  tree->nodes[node].parent = tree->free_list;
+  tree->nodes[node].height = -1;
+  tree->free_list = node;
+}
+
+aabb_t aabb_union(aabb_t box1, aabb_t box2) {
+  aabb_t result = {
+      .min = {fmin(box1.min.x, box2.min.x), fmin(box1.min.y, box2.min.y)},
+      .max = {fmax(box1.max.x, box2.max.x), fmax(box1.max.y, box2.max.y)}};
+  return result;
+}
+
+/**
+ * The surface area heuristic's cost of a box, which in 2D is its perimeter.
+ */
+double aabb_perimeter(aabb_t box) {
+  return 2 * ((box.max.x - box.min.x) + (box.max.y - box.min.y));
+}
+
+bool aabb_contains(aabb_t outer, aabb_t inner) {
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+         inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+}
+
+/**
+ * Rotates the subtree rooted at a node if its children's heights differ by
+ * more than one, and returns the node now at the subtree's root.
+ */
+size_t aabb_tree_balance(aabb_tree_t *tree, size_t a) {
+  aabb_tree_node_t *nodes = tree->nodes;
+  if (nodes[a].height < 2)
+    return a;
+  size_t b = nodes[a].child1;
+  size_t c = nodes[a].child2;
+  int balance = nodes[c].height - nodes[b].height;
+  if (balance >= -1 && balance <= 1)
+    return a;
+
+  // Promote the taller child (c) and hand one of its children down to a
+  bool promote_c = balance > 1;
+  if (!promote_c) {
+    size_t temp = b;
+    b = c;
+    c = temp;
+  }
+  size_t f = nodes[c].child1;
+  size_t g = nodes[c].child2;
+  nodes[c].child1 = a;
+  nodes[c].parent = nodes[a].parent;
+  nodes[a].parent = c;
+  if (nodes[c].parent == AABB_TREE_NULL) {
+    tree->root = c;
+  } else if (nodes[nodes[c].parent].child1 == a) {
+    nodes[nodes[c].parent].child1 = c;
+  } else {
+    nodes[nodes[c].parent].child2 = c;
+  }
+
+  // Keep the taller grandchild under c
+  size_t kept = f;
+  size_t moved = g;
+  if (nodes[g].height > nodes[f].height) {
+    kept = g;
+    moved = f;
+  }
+  nodes[c].child2 = kept;
+  if (promote_c)
+    nodes[a].child2 = moved;
+  else
+    nodes[a].child1 = moved;
+  nodes[moved].parent = a;
+  nodes[a].box = aabb_union(nodes[b].box, nodes[moved].box);
+  nodes[c].box = aabb_union(nodes[a].box, nodes[kept].box);
+  nodes[a].height = 1 + (nodes[b].height > nodes[moved].height
+                             ? nodes[b].height
+                             : nodes[moved].height);
+  nodes[c].height = 1 + (nodes[a].height > nodes[kept].height
+                             ? nodes[a].height
+                             : nodes[kept].height);
+  return c;
+}
+
+/**
+ * Walks from a node to the root, rebalancing and refitting each ancestor.
+ */
+void aabb_tree_refit(aabb_tree_t *tree, size_t node) {
+  while (node != AABB_TREE_NULL) {
+    node = aabb_tree_balance(tree, node);
+    aabb_tree_node_t *nodes = tree->nodes;
+    size_t child1 = nodes[node].child1;
+    size_t child2 = nodes[node].child2;
+    nodes[node].height = 1 + (nodes[child1].height > nodes[child2].height
+                                  ? nodes[child1].height
+                                  : nodes[child2].height);
+    nodes[node].box = aabb_union(nodes[child1].box, nodes[child2].box);
+    node = nodes[node].parent;
+  }
+}
+
+/**
+ * Finds the best sibling for a new leaf by the surface area heuristic
+ * and splices the leaf in next to it.
+ */
+void aabb_tree_insert_leaf(aabb_tree_t *tree, size_t leaf) {
+  if (tree->root == AABB_TREE_NULL) {
+    tree->root = leaf;
+    tree->nodes[leaf].parent = AABB_TREE_NULL;
+    return;
+  }
+
+  aabb_t box = tree->nodes[leaf].box;
+  size_t sibling = tree->root;
+  while (tree->nodes[sibling].height > 0) {
+    aabb_tree_node_t *node = &tree->nodes[sibling];
+    double area = aabb_perimeter(node->box);
+    double combined_area = aabb_perimeter(aabb_union(node->box, box));
+    // Cost of making a new parent for this node and the leaf
+    double cost = 2 * combined_area;
+    // Minimum cost of pushing the leaf further down the tree
+    double inheritance_cost = 2 * (combined_area - area);
+
+    double child_costs[2];
+    size_t children[2] = {node->child1, node->child2};
+    for (size_t i = 0; i < 2; i++) {
+      aabb_tree_node_t *child = &tree->nodes[children[i]];
+      double child_area = aabb_perimeter(aabb_union(child->box, box));
+      if (child->height > 0)
+        child_area -= aabb_perimeter(child->box);
+      child_costs[i] = child_area + inheritance_cost;
+    }
+    if (cost < child_costs[0] && cost < child_costs[1])
+      break;
+    sibling = child_costs[0] < child_costs[1] ? children[0] : children[1];
+  }
+
+  size_t old_parent = tree->nodes[sibling].parent;
+  size_t new_parent = aabb_tree_allocate_node(tree);
+  aabb_tree_node_t *nodes = tree->nodes;
+  nodes[new_parent].parent = old_parent;
+  nodes[new_parent].box = aabb_union(box, nodes[sibling].box);
+  nodes[new_parent].height = nodes[sibling].height + 1;
+  nodes[new_parent].child1 = sibling;
+  nodes[new_parent].child2 = leaf;
+  nodes[sibling].parent = new_parent;
+  nodes[leaf].parent = new_parent;
+  if (old_parent == AABB_TREE_NULL) {
+    tree->root = new_parent;
+  } else if (nodes[old_parent].child1 == sibling) {
+    nodes[old_parent].child1 = new_parent;
+  } else {
+    nodes[old_parent].child2 = new_parent;
+  }
+  aabb_tree_refit(tree, old_parent);
+}
+
+/**
+ * Unlinks a leaf from the tree, replacing its parent with its sibling.
+ */
+void aabb_tree_remove_leaf(aabb_tree_t *tree, size_t leaf) {
+  if (leaf == tree->root) {
+    tree->root = AABB_TREE_NULL;
+    return;
+  }
+  aabb_tree_node_t *nodes = tree->nodes;
+  size_t parent = nodes[leaf].parent;
+  size_t grandparent = nodes[parent].parent;
+  size_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2
+                                                : nodes[parent].child1;
+  nodes[sibling].parent = grandparent;
+  if (grandparent == AABB_TREE_NULL) {
+    tree->root = sibling;
+  } else {
+    if (nodes[grandparent].child1 == parent)
+      nodes[grandparent].child1 = sibling;
+    else
+      nodes[grandparent].child2 = sibling;
+  }
+  aabb_tree_free_node(tree, parent);
+  aabb_tree_refit(tree, grandparent);
+}
+
+/**
+ * Grows a box by the tree's margin on each side.
+ */
+aabb_t aabb_tree_fatten(aabb_tree_t *tree, aabb_t box) {
+  double margin_x = tree->margin * (box.max.x - box.min.x);
+  double margin_y = tree->margin * (box.max.y - box.min.y);
+  aabb_t result = {.min = {box.min.x - margin_x, box.min.y - margin_y},
+                   .max = {box.max.x + margin_x, box.max.y + margin_y}};
+  return result;
+}
+
+size_t aabb_tree_insert(aabb_tree_t *tree, aabb_t box, uint32_t data) {
+  size_t proxy = aabb_tree_allocate_node(tree);
+  tree->nodes[proxy].box = aabb_tree_fatten(tree, box);
+  tree->nodes[proxy].data = data;
+  aabb_tree_insert_leaf(tree, proxy);
+  tree->n_leaves++;
+  return proxy;
+}
+
+void aabb_tree_remove(aabb_tree_t *tree, size_t proxy) {
+  assert(proxy < tree->capacity && tree->nodes[proxy].height == 0);
+  aabb_tree_remove_leaf(tree, proxy);
+  aabb_tree_free_node(tree, proxy);
+  tree->n_leaves--;
+}
+
+bool aabb_tree_move(aabb_tree_t *tree, size_t proxy, aabb_t box) {
+  assert(proxy < tree->capacity && tree->nodes[proxy].height == 0);
+  if (aabb_contains(tree->nodes[proxy].box, box))
+    return false;
+  aabb_tree_remove_leaf(tree, proxy);
+  tree->nodes[proxy].box = aabb_tree_fatten(tree, box);
+  aabb_tree_insert_leaf(tree, proxy);
+  return true;
+}
+
+aabb_t aabb_tree_get_fat_aabb(aabb_tree_t *tree, size_t proxy) {
+  assert(proxy < tree->capacity && tree->nodes[proxy].height == 0);
+  return tree->nodes[proxy].box;
+}
+
+void aabb_tree_query(aabb_tree_t *tree, aabb_t region,
+                     aabb_tree_query_t callback, void *aux) {
+  if (tree->root == AABB_TREE_NULL)
+    return;
+  // A balanced tree is shallow, but the stack can hold every node regardless
+  if (tree->stack_capacity < tree->capacity) {
+    tree->stack = realloc(tree->stack, sizeof(size_t) * tree->capacity);
+    assert(tree->stack);
+    tree->stack_capacity = tree->capacity;
+  }
+  size_t n_stack = 0;
+  tree->stack[n_stack++] = tree->root;
+  while (n_stack > 0) {
+    aabb_tree_node_t *node = &tree->nodes[tree->stack[--n_stack]];
+    if (!aabb_overlaps(node->box, region))
+      continue;
+    if (node->height == 0) {
+      callback(aux, node->data);
+    } else {
+      tree->stack[n_stack++] = node->child1;
+      tree->stack[n_stack++] = node->child2;
+    }
+  }
+}
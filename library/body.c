@@ -5,17 +5,82 @@
 #include "vector.h"
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 const vector_t VELOCITY_0 = {.x = 0, .y = 0};
 const vector_t POSITION_0 = {.x = 0, .y = 0};
 const vector_t FORCE_0 = {.x = 0, .y = 0};
 const vector_t IMPULSE_0 = {.x = 0, .y = 0};
+// The pool index of a body whose kinematic state is stored in the body itself
+const size_t POOL_INDEX_NONE = SIZE_MAX;
+
+typedef struct body_slot {
+  // The body holding this slot, or NULL if the slot is free
+  body_t *body;
+  // Incremented whenever the slot is released, invalidating old handles
+  uint32_t generation;
+} body_slot_t;
+
+typedef struct body_pool {
+  body_slot_t *slots;
+  size_t n_slots;
+  size_t slots_capacity;
+  uint32_t *free_slots;
+  size_t n_free_slots;
+  body_t **bodies;
+  vector_t *centroids;
+  vector_t *velocities;
+  vector_t *forces;
+  vector_t *impulses;
+  double *masses;
+  double *inverse_masses;
+  size_t size;
+  size_t capacity;
+} body_pool_t;
 
 typedef struct body {
-  list_t *points;
+  // The shape relative to the centroid, before any rotation
+  vector_t *local_points;
+  // Cached world-space vertices, valid for world_centroid if world_valid
+  vector_t *points;
+  size_t n_points;
+  vector_t centroid;
+  // The radius of a circular body, whose vertices only approximate it,
+  // or 0 for a polygon
+  double radius;
+  // Half-widths along the first two edge normals if the shape is a
+  // rectangle, or 0 otherwise
+  vector_t half_extents;
+  double rotation;
+  double cos_rotation;
+  double sin_rotation;
+  vector_t world_centroid;
+  bool world_valid;
+  // Edge normals of the local shape, and cached normals of the rotated
+  // shape, valid if normals_valid. Translation never changes them.
+  vector_t *local_normals;
+  vector_t *normals;
+  bool normals_valid;
+  // Where searches for the vertex farthest along a direction start, if the
+  // shape is convex (see polygon_find_extreme()). Kept across ticks, since
+  // bodies and the axes they are projected onto change little between them.
+  bool convex;
+  size_t extreme_hints[POLYGON_EXTREME_HINTS];
+  // Cached bounds of the rotated local shape, valid if local_aabb_valid
+  aabb_t local_aabb;
+  bool local_aabb_valid;
+  // Bumped by every explicit change to the shape or its transform
+  uint32_t geometry_version;
+  double area;
+  double moment;
   double mass;
   vector_t velocity;
   rgb_color_t color;
@@ -23,14 +88,156 @@ typedef struct body {
   vector_t impulse;
   double angle;
   bool is_removed;
+  // Whether the body's motion is swept for collisions each tick
+  bool bullet;
   void *info;
   free_func_t info_freer;
+  // The pool holding this body's handle slot, or NULL if it has none
+  body_pool_t *pool;
+  uint32_t slot;
+  // The index of this body's kinematic state in the pool's arrays,
+  // or POOL_INDEX_NONE if it is stored above
+  size_t pool_index;
 } body_t;
 
-body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
+vector_t *body_centroid_ref(body_t *body) {
+  return body->pool_index != POOL_INDEX_NONE
+             ? &body->pool->centroids[body->pool_index]
+             : &body->centroid;
+}
+
+vector_t *body_velocity_ref(body_t *body) {
+  return body->pool_index != POOL_INDEX_NONE
+             ? &body->pool->velocities[body->pool_index]
+             : &body->velocity;
+}
+
+vector_t *body_force_ref(body_t *body) {
+  return body->pool_index != POOL_INDEX_NONE
+             ? &body->pool->forces[body->pool_index]
+             : &body->force;
+}
+
+vector_t *body_impulse_ref(body_t *body) {
+  return body->pool_index != POOL_INDEX_NONE
+             ? &body->pool->impulses[body->pool_index]
+             : &body->impulse;
+}
+
+/**
+ * Copies the vertices of a shape list into a newly allocated contiguous array.
+ * The list is freed, since bodies take ownership of the shapes they are given.
+ */
+vector_t *points_from_list(list_t *shape, size_t *n_points) {
+  assert(shape);
+  size_t size = list_size(shape);
+  vector_t *points = malloc(sizeof(vector_t) * size);
+  assert(points);
+  for (size_t i = 0; i < size; i++) {
+    points[i] = *(vector_t *)list_get(shape, i);
+  }
+  list_free(shape);
+  *n_points = size;
+  return points;
+}
+
+/**
+ * Replaces a body's shape with the given world-space vertices.
+ * Computes the cached centroid, area and moment of inertia and stores the
+ * shape relative to the centroid with no rotation. Only needed when the shape
+ * itself changes; translations and rotations just update the transform.
+ */
+void body_load_shape(body_t *body, const vector_t *points, size_t n_points) {
+  assert(n_points > 0);
+  if (n_points != body->n_points) {
+    body->local_points =
+        realloc(body->local_points, sizeof(vector_t) * n_points);
+    body->points = realloc(body->points, sizeof(vector_t) * n_points);
+    body->local_normals =
+        realloc(body->local_normals, sizeof(vector_t) * n_points);
+    body->normals = realloc(body->normals, sizeof(vector_t) * n_points);
+    assert(body->local_points);
+    assert(body->points);
+    assert(body->local_normals);
+    assert(body->normals);
+    body->n_points = n_points;
+  }
+  bool is_rectangle = polygon_is_rectangle_array(points, n_points);
+  vector_t centroid = polygon_centroid_array(points, n_points);
+  // A rectangle is projected from its center, which must agree with its
+  // vertices, so use the exact midpoint of a diagonal
+  if (is_rectangle) {
+    centroid.x = (points[0].x + points[2].x) / 2;
+    centroid.y = (points[0].y + points[2].y) / 2;
+  }
+  body->area = polygon_area_array(points, n_points);
+  body->moment = body->mass / body->area *
+                 polygon_moment_array(points, n_points, centroid);
+  body->radius = 0;
+  for (size_t i = 0; i < n_points; i++) {
+    body->local_points[i] = vec_subtract(points[i], centroid);
+  }
+  polygon_edge_normals_array(body->local_points, n_points,
+                             body->local_normals);
+  body->convex = polygon_is_convex_array(body->local_points, n_points);
+  for (size_t i = 0; i < POLYGON_EXTREME_HINTS; i++)
+    body->extreme_hints[i] = 0;
+  body->half_extents = VEC_ZERO;
+  if (is_rectangle) {
+    vector_t edge0 = vec_subtract(body->local_points[1], body->local_points[0]);
+    vector_t edge1 = vec_subtract(body->local_points[2], body->local_points[1]);
+    body->half_extents.x = sqrt(vec_dot(edge1, edge1)) / 2;
+    body->half_extents.y = sqrt(vec_dot(edge0, edge0)) / 2;
+  }
+  *body_centroid_ref(body) = centroid;
+  body->rotation = 0;
+  body->cos_rotation = 1;
+  body->sin_rotation = 0;
+  // The world-space vertices are rebuilt from the local shape, so they agree
+  // exactly with body_get_aabb() rather than repeating the input
+  body->world_valid = false;
+  body->normals_valid = false;
+  body->local_aabb_valid = false;
+  body->geometry_version++;
+}
+
+/**
+ * Recomputes the world-space vertices of a body from its local shape and
+ * transform if they are out of date.
+ */
+void body_update_world_points(body_t *body) {
+  vector_t centroid = *body_centroid_ref(body);
+  if (body->world_valid && vec_eq(body->world_centroid, centroid))
+    return;
+  if (body->rotation == 0) {
+    for (size_t i = 0; i < body->n_points; i++) {
+      body->points[i].x = body->local_points[i].x + centroid.x;
+      body->points[i].y = body->local_points[i].y + centroid.y;
+    }
+  } else {
+    double c = body->cos_rotation;
+    double s = body->sin_rotation;
+    for (size_t i = 0; i < body->n_points; i++) {
+      vector_t local = body->local_points[i];
+      body->points[i].x = local.x * c - local.y * s + centroid.x;
+      body->points[i].y = local.y * c + local.x * s + centroid.y;
+    }
+  }
+  body->world_centroid = centroid;
+  body->world_valid = true;
+}
+
+body_t *body_init_from_array_with_info(const vector_t *points, size_t n_points,
+                                       double mass, rgb_color_t color,
+                                       void *info, free_func_t info_freer) {
   body_t *result = malloc(sizeof(body_t));
   assert(result);
-  result->points = shape;
+  result->local_points = NULL;
+  result->points = NULL;
+  result->local_normals = NULL;
+  result->normals = NULL;
+  result->n_points = 0;
+  result->geometry_version = 0;
   result->mass = mass;
   result->color = color;
   result->velocity = VELOCITY_0;
@@ -38,111 +245,252 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
   result->impulse = IMPULSE_0;
   result->angle = M_PI;
   result->is_removed = false;
-  result->info = NULL;
-  result->info_freer = NULL;
+  result->bullet = false;
+  result->info = info;
+  result->info_freer = info_freer;
+  result->pool = NULL;
+  result->slot = 0;
+  result->pool_index = POOL_INDEX_NONE;
+  body_load_shape(result, points, n_points);
   return result;
 }
 
+body_t *body_init_from_array(const vector_t *points, size_t n_points,
+                             double mass, rgb_color_t color) {
+  return body_init_from_array_with_info(points, n_points, mass, color, NULL,
+                                        NULL);
+}
+
+body_t *body_init_circle_with_info(vector_t center, double radius,
+                                   size_t n_points, double mass,
+                                   rgb_color_t color, void *info,
+                                   free_func_t info_freer) {
+  assert(radius > 0);
+  assert(n_points >= 3);
+  vector_t points[n_points];
+  for (size_t i = 0; i < n_points; i++) {
+    double angle = 2 * M_PI * i / n_points;
+    points[i].x = center.x + radius * cos(angle);
+    points[i].y = center.y + radius * sin(angle);
+  }
+  body_t *result = body_init_from_array_with_info(points, n_points, mass,
+                                                  color, info, info_freer);
+  // The polygon's centroid only approximates the center
+  *body_centroid_ref(result) = center;
+  result->radius = radius;
+  result->half_extents = VEC_ZERO;
+  result->area = M_PI * radius * radius;
+  result->moment = mass * radius * radius / 2;
+  return result;
+}
+
+body_t *body_init_circle(vector_t center, double radius, size_t n_points,
+                         double mass, rgb_color_t color) {
+  return body_init_circle_with_info(center, radius, n_points, mass, color,
+                                    NULL, NULL);
+}
+
+body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
+  return body_init_with_info(shape, mass, color, NULL, NULL);
+}
+
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
                             void *info, free_func_t info_freer) {
-  body_t *result = malloc(sizeof(body_t));
-  assert(result);
-  result->points = shape;
-  result->mass = mass;
-  result->color = color;
-  result->velocity = VELOCITY_0;
-  result->force = FORCE_0;
-  result->impulse = IMPULSE_0;
-  result->angle = M_PI;
-  result->is_removed = false;
-  result->info = info;
-  result->info_freer = info_freer;
+  size_t n_points;
+  vector_t *points = points_from_list(shape, &n_points);
+  body_t *result = body_init_from_array_with_info(points, n_points, mass,
+                                                  color, info, info_freer);
+  free(points);
   return result;
 }
 
 void body_free(void *to_free) {
   body_t *body = (body_t *)to_free;
+  assert(body->pool_index == POOL_INDEX_NONE);
+  // A body that was given a handle but never added to its pool still holds
+  // a slot, which must be released for reuse and to invalidate the handle
+  if (body->pool != NULL)
+    body_pool_remove(body->pool, body);
   if (body->info != NULL && body->info_freer != NULL)
     body->info_freer(body->info);
   assert(body->points);
-  list_free(body->points);
+  free(body->local_points);
+  free(body->points);
+  free(body->local_normals);
+  free(body->normals);
   free(body);
 }
 
 list_t *body_get_shape(body_t *body) {
-  list_t *result = list_init(list_size(body->points), free);
-  for (size_t i = 0; i < list_size(body->points); i++) {
-    vector_t *v = list_get(body->points, i);
+  body_update_world_points(body);
+  list_t *result = list_init(body->n_points, free);
+  for (size_t i = 0; i < body->n_points; i++) {
     vector_t *to_add = malloc(sizeof(vector_t));
-    to_add->x = v->x;
-    to_add->y = v->y;
+    assert(to_add);
+    *to_add = body->points[i];
     list_add(result, to_add);
   }
   assert(result);
   return result;
 }
 
-vector_t body_get_centroid(body_t *body) {
-  return polygon_centroid(body->points);
+/**
+ * Rotates the local edge normals into the cached normals
+ * if the body was rotated since they were last computed.
+ */
+void body_update_normals(body_t *body) {
+  if (body->normals_valid || body->rotation == 0)
+    return;
+  double c = body->cos_rotation;
+  double s = body->sin_rotation;
+  for (size_t i = 0; i < body->n_points; i++) {
+    vector_t local = body->local_normals[i];
+    body->normals[i].x = local.x * c - local.y * s;
+    body->normals[i].y = local.y * c + local.x * s;
+  }
+  body->normals_valid = true;
+}
+
+shape_view_t body_get_shape_view(body_t *body) {
+  body_update_world_points(body);
+  body_update_normals(body);
+  shape_view_t result = {.points = body->points,
+                         .size = body->n_points,
+                         .normals = body->rotation == 0 ? body->local_normals
+                                                        : body->normals,
+                         .radius = body->radius,
+                         .center = *body_centroid_ref(body),
+                         .half_extents = body->half_extents,
+                         .extreme_hints =
+                             body->convex ? body->extreme_hints : NULL};
+  return result;
+}
+
+/**
+ * Recomputes the bounds of a body's rotated local shape if they are out of
+ * date. The rotated vertices are computed exactly as in
+ * body_update_world_points(), so translating these bounds by the centroid
+ * gives the same box as bounding the world-space vertices.
+ */
+void body_update_local_aabb(body_t *body) {
+  if (body->local_aabb_valid)
+    return;
+  if (body->radius > 0) {
+    // A circle's bounds do not depend on its rotation
+    aabb_t circle = {.min = {-body->radius, -body->radius},
+                     .max = {body->radius, body->radius}};
+    body->local_aabb = circle;
+    body->local_aabb_valid = true;
+    return;
+  }
+  double c = body->cos_rotation;
+  double s = body->sin_rotation;
+  aabb_t result = {.min = {INFINITY, INFINITY}, .max = {-INFINITY, -INFINITY}};
+  for (size_t i = 0; i < body->n_points; i++) {
+    vector_t local = body->local_points[i];
+    vector_t rotated = local;
+    if (body->rotation != 0) {
+      rotated.x = local.x * c - local.y * s;
+      rotated.y = local.y * c + local.x * s;
+    }
+    result.min.x = fmin(result.min.x, rotated.x);
+    result.min.y = fmin(result.min.y, rotated.y);
+    result.max.x = fmax(result.max.x, rotated.x);
+    result.max.y = fmax(result.max.y, rotated.y);
+  }
+  body->local_aabb = result;
+  body->local_aabb_valid = true;
+}
+
+aabb_t body_get_aabb(body_t *body) {
+  body_update_local_aabb(body);
+  vector_t centroid = *body_centroid_ref(body);
+  aabb_t result = {.min = {body->local_aabb.min.x + centroid.x,
+                           body->local_aabb.min.y + centroid.y},
+                   .max = {body->local_aabb.max.x + centroid.x,
+                           body->local_aabb.max.y + centroid.y}};
+  return result;
+}
+
+uint32_t body_get_geometry_version(body_t *body) {
+  return body->geometry_version;
 }
 
-vector_t body_get_velocity(body_t *body) { return body->velocity; }
+vector_t body_get_centroid(body_t *body) { return *body_centroid_ref(body); }
+
+double body_get_area(body_t *body) { return body->area; }
+
+double body_get_moment(body_t *body) { return body->moment; }
+
+vector_t body_get_velocity(body_t *body) { return *body_velocity_ref(body); }
 
 rgb_color_t body_get_color(body_t *body) { return body->color; }
 
 void body_set_color(body_t *body, rgb_color_t color) { body->color = color; }
 
 void body_set_centroid(body_t *body, vector_t x) {
-  vector_t current_centroid = body_get_centroid(body);
-  polygon_translate(body->points, vec_subtract(x, current_centroid));
+  *body_centroid_ref(body) = x;
+  body->geometry_version++;
 }
 
-void body_set_velocity(body_t *body, vector_t v) { body->velocity = v; }
+void body_set_velocity(body_t *body, vector_t v) {
+  *body_velocity_ref(body) = v;
+}
 
 void body_set_rotation(body_t *body, double angle) {
-  list_t *temp_list = list_init(list_size(body->points), free);
-  for (size_t i = 0; i < list_size(body->points); i++) {
-    vector_t vec = vec_subtract(*(vector_t *)list_get(body->points, i),
-                                body_get_centroid(body));
-    vec = vec_rotate(vec, angle);
-    vector_t final_vec = vec_add(vec, body_get_centroid(body));
-    vector_t *final_vec_pointer = malloc(sizeof(vector_t));
-    assert(final_vec_pointer);
-    final_vec_pointer->x = final_vec.x;
-    final_vec_pointer->y = final_vec.y;
-    list_add(temp_list, final_vec_pointer);
-  }
-  list_free(body->points);
-  body->points = temp_list;
+  // Rotating about the centroid leaves the centroid, area and moment unchanged
+  body->rotation += angle;
+  body->cos_rotation = cos(body->rotation);
+  body->sin_rotation = sin(body->rotation);
+  body->world_valid = false;
+  body->normals_valid = false;
+  body->local_aabb_valid = false;
+  body->geometry_version++;
 }
 
 double calculate_net_force(body_t *body) {
-  return sqrt((body->force.x) * (body->force.x) +
-              (body->force.y) * (body->force.y));
+  vector_t *force = body_force_ref(body);
+  return sqrt((force->x) * (force->x) + (force->y) * (force->y));
 }
 
-void body_tick(body_t *body, double dt) {
-  vector_t old_velocity = body->velocity;
-  vector_t acc = {.x = body->force.x / body->mass,
-                  .y = body->force.y / body->mass};
-  body->velocity = vec_add(
-      body->velocity, vec_multiply(1 / body_get_mass(body), body->impulse));
-  vector_t new_velocity = {.x = body->velocity.x + acc.x * dt,
-                           .y = body->velocity.y + acc.y * dt};
-  body->velocity = new_velocity;
+/**
+ * Advances a single body's kinematic state.
+ * Shared by body_tick() and body_pool_tick() so both integrate identically.
+ */
+void integrate(vector_t *centroid, vector_t *velocity, vector_t *force,
+               vector_t *impulse, double mass, double inverse_mass,
+               double dt) {
+  vector_t old_velocity = *velocity;
+  vector_t acc = {.x = force->x / mass, .y = force->y / mass};
+  *velocity = vec_add(*velocity, vec_multiply(inverse_mass, *impulse));
+  vector_t new_velocity = {.x = velocity->x + acc.x * dt,
+                           .y = velocity->y + acc.y * dt};
+  *velocity = new_velocity;
   vector_t difference =
       vec_multiply(dt / 2, vec_add(old_velocity, new_velocity));
-  vector_t centroid = vec_add(body_get_centroid(body), difference);
-  body_set_centroid(body, centroid);
-  body->force = VEC_ZERO;
-  body->impulse = VEC_ZERO;
+  *centroid = vec_add(*centroid, difference);
+  *force = VEC_ZERO;
+  *impulse = VEC_ZERO;
 }
 
-size_t body_get_n_points(body_t *body) { return list_size(body->points) / 2; }
+void body_tick(body_t *body, double dt) {
+  integrate(body_centroid_ref(body), body_velocity_ref(body),
+            body_force_ref(body), body_impulse_ref(body), body->mass,
+            1 / body->mass, dt);
+}
+
+size_t body_get_n_points(body_t *body) { return body->n_points / 2; }
+
+void body_set_points_array(body_t *body, const vector_t *points,
+                           size_t n_points) {
+  body_load_shape(body, points, n_points);
+}
 
 void body_set_points(body_t *body, list_t *points) {
-  list_free(body->points);
-  body->points = points;
+  size_t n_points;
+  vector_t *array = points_from_list(points, &n_points);
+  body_load_shape(body, array, n_points);
+  free(array);
 }
 
 double body_get_angle(body_t *body) { return body->angle; }
@@ -151,16 +499,26 @@ void body_set_angle(body_t *body, double angle) { body->angle = angle; }
 
 double body_get_mass(body_t *body) { return body->mass; }
 
-void body_set_force(body_t *body, vector_t force) { body->force = force; }
+double body_get_radius(body_t *body) { return body->radius; }
+
+bool body_is_box(body_t *body) { return body->half_extents.x > 0; }
+
+void body_set_force(body_t *body, vector_t force) {
+  *body_force_ref(body) = force;
+}
 
 void body_add_force(body_t *body, vector_t force) {
-  body->force = vec_add(body->force, force);
+  vector_t *current = body_force_ref(body);
+  *current = vec_add(*current, force);
 }
 
-vector_t body_get_force(body_t *body) { return body->force; }
+vector_t body_get_force(body_t *body) { return *body_force_ref(body); }
+
+vector_t body_get_impulse(body_t *body) { return *body_impulse_ref(body); }
 
 void body_add_impulse(body_t *body, vector_t impulse) {
-  body->impulse = vec_add(body->impulse, impulse);
+  vector_t *current = body_impulse_ref(body);
+  *current = vec_add(*current, impulse);
 }
 
 void *body_get_info(body_t *body) { return body->info; }
@@ -169,15 +527,263 @@ void body_remove(body_t *body) { body->is_removed = true; }
 
 bool body_is_removed(body_t *body) { return body->is_removed; }
 
+void body_set_bullet(body_t *body, bool bullet) { body->bullet = bullet; }
+
+bool body_is_bullet(body_t *body) { return body->bullet; }
+
 bool body_is_player(body_t *body) { return body->info == 0; }
 
 void body_reset(body_t *body) {
-  body->velocity = VELOCITY_0;
-  body->impulse = IMPULSE_0;
-  body->force = FORCE_0;
+  *body_velocity_ref(body) = VELOCITY_0;
+  *body_impulse_ref(body) = IMPULSE_0;
+  *body_force_ref(body) = FORCE_0;
 }
 
 void body_decrease_velocity(body_t *body, double factor) {
-  vector_t new_velocity = vec_multiply(factor, body->velocity); 
-  body->velocity = new_velocity;
-}
\ No newline at end of file
+  vector_t new_velocity = vec_multiply(factor, *body_velocity_ref(body)); 
+  *body_velocity_ref(body) = new_velocity;
+}
+
+body_pool_t *body_pool_init(size_t capacity) {
+  body_pool_t *result = malloc(sizeof(body_pool_t));
+  assert(result);
+  result->slots = NULL;
+  result->n_slots = 0;
+  result->slots_capacity = 0;
+  result->free_slots = NULL;
+  result->n_free_slots = 0;
+  result->bodies = NULL;
+  result->centroids = NULL;
+  result->velocities = NULL;
+  result->forces = NULL;
+  result->impulses = NULL;
+  result->masses = NULL;
+  result->inverse_masses = NULL;
+  result->size = 0;
+  result->capacity = 0;
+  body_pool_reserve(result, capacity);
+  return result;
+}
+
+void body_pool_reserve(body_pool_t *pool, size_t capacity) {
+  if (capacity <= pool->capacity)
+    return;
+  pool->bodies = realloc(pool->bodies, sizeof(body_t *) * capacity);
+  pool->centroids = realloc(pool->centroids, sizeof(vector_t) * capacity);
+  pool->velocities = realloc(pool->velocities, sizeof(vector_t) * capacity);
+  pool->forces = realloc(pool->forces, sizeof(vector_t) * capacity);
+  pool->impulses = realloc(pool->impulses, sizeof(vector_t) * capacity);
+  pool->masses = realloc(pool->masses, sizeof(double) * capacity);
+  pool->inverse_masses =
+      realloc(pool->inverse_masses, sizeof(double) * capacity);
+  assert(pool->bodies && pool->centroids && pool->velocities && pool->forces &&
+         pool->impulses && pool->masses && pool->inverse_masses);
+  pool->capacity = capacity;
+}
+
+void body_pool_free(body_pool_t *pool) {
+  for (size_t i = 0; i < pool->n_slots; i++) {
+    body_t *body = pool->slots[i].body;
+    if (body != NULL)
+      body_pool_remove(pool, body);
+  }
+  free(pool->slots);
+  free(pool->free_slots);
+  free(pool->bodies);
+  free(pool->centroids);
+  free(pool->velocities);
+  free(pool->forces);
+  free(pool->impulses);
+  free(pool->masses);
+  free(pool->inverse_masses);
+  free(pool);
+}
+
+size_t body_pool_size(body_pool_t *pool) { return pool->size; }
+
+/**
+ * Assigns a body a handle slot in a pool, reusing a released slot if possible.
+ */
+void body_pool_reserve_slot(body_pool_t *pool, body_t *body) {
+  assert(body->pool == NULL);
+  uint32_t slot;
+  if (pool->n_free_slots > 0) {
+    slot = pool->free_slots[--pool->n_free_slots];
+  } else {
+    if (pool->n_slots >= pool->slots_capacity) {
+      pool->slots_capacity =
+          pool->slots_capacity == 0 ? 1 : pool->slots_capacity * 2;
+      pool->slots =
+          realloc(pool->slots, sizeof(body_slot_t) * pool->slots_capacity);
+      pool->free_slots =
+          realloc(pool->free_slots, sizeof(uint32_t) * pool->slots_capacity);
+      assert(pool->slots && pool->free_slots);
+    }
+    slot = pool->n_slots++;
+    pool->slots[slot].generation = 1;
+  }
+  pool->slots[slot].body = body;
+  body->pool = pool;
+  body->slot = slot;
+}
+
+body_handle_t body_pool_get_handle(body_pool_t *pool, body_t *body) {
+  if (body->pool != pool) {
+    // Slot generations start at 1, so this never resolves
+    body_handle_t invalid = {.index = 0, .generation = 0};
+    return invalid;
+  }
+  body_handle_t result = {.index = body->slot,
+                          .generation = pool->slots[body->slot].generation};
+  return result;
+}
+
+body_handle_t body_pool_reserve_handle(body_pool_t *pool, body_t *body) {
+  if (body->pool == NULL)
+    body_pool_reserve_slot(pool, body);
+  assert(body->pool == pool);
+  return body_pool_get_handle(pool, body);
+}
+
+body_t *body_pool_resolve(body_pool_t *pool, body_handle_t handle) {
+  if (handle.index >= pool->n_slots)
+    return NULL;
+  body_slot_t *slot = &pool->slots[handle.index];
+  return slot->generation == handle.generation ? slot->body : NULL;
+}
+
+bool body_handle_is_valid(body_pool_t *pool, body_handle_t handle) {
+  return body_pool_resolve(pool, handle) != NULL;
+}
+
+void body_pool_add(body_pool_t *pool, body_t *body) {
+  body_pool_reserve_handle(pool, body);
+  assert(body->pool_index == POOL_INDEX_NONE);
+  if (pool->size >= pool->capacity)
+    body_pool_reserve(pool, pool->capacity == 0 ? 1 : pool->capacity * 2);
+  size_t index = pool->size++;
+  pool->bodies[index] = body;
+  pool->centroids[index] = body->centroid;
+  pool->velocities[index] = body->velocity;
+  pool->forces[index] = body->force;
+  pool->impulses[index] = body->impulse;
+  pool->masses[index] = body->mass;
+  pool->inverse_masses[index] = 1 / body->mass;
+  body->pool_index = index;
+}
+
+void body_pool_remove(body_pool_t *pool, body_t *body) {
+  assert(body->pool == pool);
+  // Releasing the slot invalidates every outstanding handle to the body
+  body_slot_t *slot = &pool->slots[body->slot];
+  slot->body = NULL;
+  slot->generation++;
+  // Generation 0 is left to invalid handles, even once it wraps around
+  if (slot->generation == 0)
+    slot->generation = 1;
+  pool->free_slots[pool->n_free_slots++] = body->slot;
+  body->pool = NULL;
+  size_t index = body->pool_index;
+  if (index == POOL_INDEX_NONE)
+    return;
+  body->centroid = pool->centroids[index];
+  body->velocity = pool->velocities[index];
+  body->force = pool->forces[index];
+  body->impulse = pool->impulses[index];
+  body->pool_index = POOL_INDEX_NONE;
+  // Move the last body into the hole so the arrays stay dense
+  size_t last = --pool->size;
+  if (index != last) {
+    pool->bodies[index] = pool->bodies[last];
+    pool->centroids[index] = pool->centroids[last];
+    pool->velocities[index] = pool->velocities[last];
+    pool->forces[index] = pool->forces[last];
+    pool->impulses[index] = pool->impulses[last];
+    pool->masses[index] = pool->masses[last];
+    pool->inverse_masses[index] = pool->inverse_masses[last];
+    pool->bodies[index]->pool_index = index;
+  }
+}
+
+/**
+ * Integrates bodies [start, end) of a pool one at a time with integrate().
+ */
+void body_pool_tick_scalar(body_pool_t *pool, size_t start, size_t end,
+                           double dt) {
+  for (size_t i = start; i < end; i++) {
+    integrate(&pool->centroids[i], &pool->velocities[i], &pool->forces[i],
+              &pool->impulses[i], pool->masses[i], pool->inverse_masses[i],
+              dt);
+  }
+}
+
+/*
+ * The vector kernels below perform exactly the same sequence of IEEE
+ * operations as integrate() on each (x, y) lane, so they produce bit-for-bit
+ * the same results. A vector_t is two adjacent doubles, so one SSE2 register
+ * holds one body and one AVX register holds two. The AVX kernel is only
+ * compiled when the compiler targets AVX, e.g. with 'make SIMD=avx2'.
+ */
+#if defined(__AVX__)
+void body_pool_tick(body_pool_t *pool, double dt) {
+  double *centroids = (double *)pool->centroids;
+  double *velocities = (double *)pool->velocities;
+  double *forces = (double *)pool->forces;
+  double *impulses = (double *)pool->impulses;
+  __m256d dt_v = _mm256_set1_pd(dt);
+  __m256d half_dt = _mm256_set1_pd(dt / 2);
+  __m256d zero = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 2 <= pool->size; i += 2) {
+    double m0 = pool->masses[i], m1 = pool->masses[i + 1];
+    double inv0 = pool->inverse_masses[i], inv1 = pool->inverse_masses[i + 1];
+    __m256d mass = _mm256_set_pd(m1, m1, m0, m0);
+    __m256d inverse_mass = _mm256_set_pd(inv1, inv1, inv0, inv0);
+    __m256d old_velocity = _mm256_loadu_pd(&velocities[2 * i]);
+    __m256d acc = _mm256_div_pd(_mm256_loadu_pd(&forces[2 * i]), mass);
+    __m256d velocity = _mm256_add_pd(
+        old_velocity,
+        _mm256_mul_pd(_mm256_loadu_pd(&impulses[2 * i]), inverse_mass));
+    __m256d new_velocity = _mm256_add_pd(velocity, _mm256_mul_pd(acc, dt_v));
+    __m256d difference =
+        _mm256_mul_pd(_mm256_add_pd(old_velocity, new_velocity), half_dt);
+    _mm256_storeu_pd(&centroids[2 * i],
+                     _mm256_add_pd(_mm256_loadu_pd(&centroids[2 * i]),
+                                   difference));
+    _mm256_storeu_pd(&velocities[2 * i], new_velocity);
+    _mm256_storeu_pd(&forces[2 * i], zero);
+    _mm256_storeu_pd(&impulses[2 * i], zero);
+  }
+  body_pool_tick_scalar(pool, i, pool->size, dt);
+}
+#elif defined(__SSE2__)
+void body_pool_tick(body_pool_t *pool, double dt) {
+  double *centroids = (double *)pool->centroids;
+  double *velocities = (double *)pool->velocities;
+  double *forces = (double *)pool->forces;
+  double *impulses = (double *)pool->impulses;
+  __m128d dt_v = _mm_set1_pd(dt);
+  __m128d half_dt = _mm_set1_pd(dt / 2);
+  __m128d zero = _mm_setzero_pd();
+  for (size_t i = 0; i < pool->size; i++) {
+    __m128d mass = _mm_set1_pd(pool->masses[i]);
+    __m128d inverse_mass = _mm_set1_pd(pool->inverse_masses[i]);
+    __m128d old_velocity = _mm_loadu_pd(&velocities[2 * i]);
+    __m128d acc = _mm_div_pd(_mm_loadu_pd(&forces[2 * i]), mass);
+    __m128d velocity = _mm_add_pd(
+        old_velocity, _mm_mul_pd(_mm_loadu_pd(&impulses[2 * i]), inverse_mass));
+    __m128d new_velocity = _mm_add_pd(velocity, _mm_mul_pd(acc, dt_v));
+    __m128d difference =
+        _mm_mul_pd(_mm_add_pd(old_velocity, new_velocity), half_dt);
+    _mm_storeu_pd(&centroids[2 * i],
+                  _mm_add_pd(_mm_loadu_pd(&centroids[2 * i]), difference));
+    _mm_storeu_pd(&velocities[2 * i], new_velocity);
+    _mm_storeu_pd(&forces[2 * i], zero);
+    _mm_storeu_pd(&impulses[2 * i], zero);
+  }
+}
+#else
+void body_pool_tick(body_pool_t *pool, double dt) {
+  body_pool_tick_scalar(pool, 0, pool->size, dt);
+}
+#endif
@@ -0,0 +1,711 @@
+#include "broadphase.h"
+#include "aabb_tree.h"
+#include "body.h"
+#include "collision.h"
+#include "list.h"
+#include "polygon.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cells are this many times the mean body extent on a side
+const double GRID_CELL_SCALE = 2;
+// Bodies covering more cells than this are tested against every candidate
+// by their bounding boxes instead of being inserted into the grid
+const size_t GRID_MAX_CELLS_PER_BODY = 64;
+const size_t BROADPHASE_INITIAL_CAPACITY = 16;
+// Tree proxies extend this fraction of a body's size past it on each side
+const double BROADPHASE_TREE_MARGIN = 0.2;
+
+typedef struct broadphase_entry {
+  aabb_t aabb;
+  // The slot's handle generation and the body's geometry version at the build
+  uint32_t generation;
+  uint32_t version;
+  // The entry is only valid if this matches the broadphase's stamp
+  uint32_t stamp;
+  // The slot's generation and the body's geometry version the last time
+  // pairs were found, so a body moved explicitly since then is not static
+  uint32_t found_generation;
+  uint32_t found_version;
+  // The first grid cell the body's box covers, and whether it covers too
+  // many cells to be inserted into the grid
+  int64_t cell_min_x;
+  int64_t cell_min_y;
+  bool oversized;
+  // The generation of the body whose endpoints are in the sweep-and-prune
+  // list, or 0 if the slot has none
+  uint32_t sap_generation;
+  size_t sap_active_index;
+  // The generation of the body whose proxy is in one of the trees,
+  // or 0 if the slot has none
+  uint32_t tree_generation;
+  size_t tree_proxy;
+  // Whether the proxy is in the static tree rather than the dynamic one
+  bool tree_is_static;
+  // Whether the body was static at the build; static pairs are not reported
+  bool is_static;
+} broadphase_entry_t;
+
+typedef struct sap_endpoint {
+  double value;
+  uint32_t slot;
+  bool is_min;
+} sap_endpoint_t;
+
+typedef struct grid_cell {
+  int64_t x;
+  int64_t y;
+  // The first node of the cell's linked list of bodies
+  size_t head;
+  // The cell is only occupied if this matches the broadphase's stamp
+  uint32_t stamp;
+} grid_cell_t;
+
+typedef struct grid_node {
+  uint32_t slot;
+  size_t next;
+} grid_node_t;
+
+typedef struct broadphase {
+  broadphase_kind_t kind;
+  body_pool_t *pool;
+  bool is_valid;
+  uint32_t stamp;
+
+  // Indexed by body slot
+  broadphase_entry_t *entries;
+  size_t entries_capacity;
+
+  // Open-addressed hash table of cells, with a power of two capacity
+  double cell_size;
+  grid_cell_t *cells;
+  size_t cells_capacity;
+  size_t *used_cells;
+  size_t n_used_cells;
+  grid_node_t *nodes;
+  size_t n_nodes;
+  size_t nodes_capacity;
+
+  // Sweep-and-prune endpoints on the x axis, kept sorted across builds
+  sap_endpoint_t *endpoints;
+  size_t n_endpoints;
+  size_t endpoints_capacity;
+  uint32_t *active;
+
+  // Bounding volume trees of bodies that cannot move by themselves
+  // and of every other body
+  aabb_tree_t *static_tree;
+  aabb_tree_t *dynamic_tree;
+} broadphase_t;
+
+// Marks the end of a cell's linked list of nodes
+const size_t GRID_NODE_NONE = SIZE_MAX;
+
+broadphase_t *broadphase_init(body_pool_t *pool, broadphase_kind_t kind) {
+  broadphase_t *result = malloc(sizeof(broadphase_t));
+  assert(result);
+  result->kind = kind;
+  result->pool = pool;
+  result->is_valid = false;
+  result->stamp = 0;
+  result->entries = NULL;
+  result->entries_capacity = 0;
+  result->cell_size = 1;
+  result->cells = NULL;
+  result->cells_capacity = 0;
+  result->used_cells = NULL;
+  result->n_used_cells = 0;
+  result->nodes = NULL;
+  result->n_nodes = 0;
+  result->nodes_capacity = 0;
+  result->endpoints = NULL;
+  result->n_endpoints = 0;
+  result->endpoints_capacity = 0;
+  result->active = NULL;
+  result->static_tree = aabb_tree_init(BROADPHASE_TREE_MARGIN);
+  result->dynamic_tree = aabb_tree_init(BROADPHASE_TREE_MARGIN);
+  return result;
+}
+
+void broadphase_free(broadphase_t *broadphase) {
+  free(broadphase->entries);
+  free(broadphase->cells);
+  free(broadphase->used_cells);
+  free(broadphase->nodes);
+  free(broadphase->endpoints);
+  free(broadphase->active);
+  aabb_tree_free(broadphase->static_tree);
+  aabb_tree_free(broadphase->dynamic_tree);
+  free(broadphase);
+}
+
+void broadphase_set_kind(broadphase_t *broadphase, broadphase_kind_t kind) {
+  broadphase->kind = kind;
+  broadphase->is_valid = false;
+}
+
+broadphase_kind_t broadphase_get_kind(broadphase_t *broadphase) {
+  return broadphase->kind;
+}
+
+void broadphase_invalidate(broadphase_t *broadphase) {
+  broadphase->is_valid = false;
+}
+
+/**
+ * Mixes a 64-bit key into a well-distributed hash.
+ */
+uint64_t hash_u64(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+/**
+ * Starts a new build: entries and cells from earlier builds
+ * all become stale at once.
+ */
+void broadphase_next_stamp(broadphase_t *broadphase) {
+  broadphase->stamp++;
+  if (broadphase->stamp == 0) {
+    // The stamp wrapped around, so old stamps could look current again
+    for (size_t i = 0; i < broadphase->entries_capacity; i++)
+      broadphase->entries[i].stamp = 0;
+    for (size_t i = 0; i < broadphase->cells_capacity; i++)
+      broadphase->cells[i].stamp = 0;
+    broadphase->stamp = 1;
+  }
+  broadphase->n_used_cells = 0;
+  broadphase->n_nodes = 0;
+}
+
+broadphase_entry_t *broadphase_entry(broadphase_t *broadphase, uint32_t slot) {
+  if (slot >= broadphase->entries_capacity) {
+    size_t capacity = broadphase->entries_capacity == 0
+                          ? BROADPHASE_INITIAL_CAPACITY
+                          : broadphase->entries_capacity;
+    while (capacity <= slot)
+      capacity *= 2;
+    broadphase->entries =
+        realloc(broadphase->entries, sizeof(broadphase_entry_t) * capacity);
+    assert(broadphase->entries);
+    for (size_t i = broadphase->entries_capacity; i < capacity; i++) {
+      broadphase->entries[i].stamp = 0;
+      broadphase->entries[i].found_generation = 0;
+      broadphase->entries[i].sap_generation = 0;
+      broadphase->entries[i].tree_generation = 0;
+    }
+    broadphase->entries_capacity = capacity;
+  }
+  return &broadphase->entries[slot];
+}
+
+/**
+ * Makes room for a given number of cell insertions in the grid.
+ * The cell table is kept at most half full.
+ */
+void grid_reserve(broadphase_t *broadphase, size_t n_insertions) {
+  if (n_insertions > broadphase->nodes_capacity) {
+    broadphase->nodes =
+        realloc(broadphase->nodes, sizeof(grid_node_t) * n_insertions);
+    broadphase->used_cells =
+        realloc(broadphase->used_cells, sizeof(size_t) * n_insertions);
+    assert(broadphase->nodes && broadphase->used_cells);
+    broadphase->nodes_capacity = n_insertions;
+  }
+  if (2 * n_insertions > broadphase->cells_capacity) {
+    size_t capacity = broadphase->cells_capacity == 0
+                          ? BROADPHASE_INITIAL_CAPACITY
+                          : broadphase->cells_capacity;
+    while (capacity < 2 * n_insertions)
+      capacity *= 2;
+    free(broadphase->cells);
+    broadphase->cells = calloc(capacity, sizeof(grid_cell_t));
+    assert(broadphase->cells);
+    broadphase->cells_capacity = capacity;
+  }
+}
+
+void grid_insert(broadphase_t *broadphase, int64_t x, int64_t y,
+                 uint32_t slot) {
+  size_t mask = broadphase->cells_capacity - 1;
+  uint64_t key = ((uint64_t)x * 0x9e3779b97f4a7c15ULL) ^ (uint64_t)y;
+  size_t i = hash_u64(key) & mask;
+  grid_cell_t *cell = &broadphase->cells[i];
+  while (cell->stamp == broadphase->stamp && (cell->x != x || cell->y != y)) {
+    i = (i + 1) & mask;
+    cell = &broadphase->cells[i];
+  }
+  if (cell->stamp != broadphase->stamp) {
+    cell->x = x;
+    cell->y = y;
+    cell->head = GRID_NODE_NONE;
+    cell->stamp = broadphase->stamp;
+    broadphase->used_cells[broadphase->n_used_cells++] = i;
+  }
+  size_t node = broadphase->n_nodes++;
+  broadphase->nodes[node].slot = slot;
+  broadphase->nodes[node].next = cell->head;
+  cell->head = node;
+}
+
+/**
+ * Gets the range of grid cells covered by a bounding box.
+ */
+void grid_cell_range(broadphase_t *broadphase, aabb_t aabb, int64_t *min_x,
+                     int64_t *min_y, int64_t *max_x, int64_t *max_y) {
+  double size = broadphase->cell_size;
+  *min_x = (int64_t)floor(aabb.min.x / size);
+  *min_y = (int64_t)floor(aabb.min.y / size);
+  *max_x = (int64_t)floor(aabb.max.x / size);
+  *max_y = (int64_t)floor(aabb.max.y / size);
+}
+
+/**
+ * Reports a pair of slots from the current build.
+ */
+void broadphase_report_pair(broadphase_t *broadphase, uint32_t slot1,
+                            uint32_t slot2, broadphase_pair_found_t found,
+                            void *aux) {
+  body_handle_t handle1 = {.index = slot1,
+                           .generation = broadphase->entries[slot1].generation};
+  body_handle_t handle2 = {.index = slot2,
+                           .generation = broadphase->entries[slot2].generation};
+  found(aux, handle1, handle2);
+}
+
+/**
+ * Buckets every body's bounding box into grid cells.
+ */
+void broadphase_build_grid(broadphase_t *broadphase, list_t *bodies) {
+  size_t n_bodies = list_size(bodies);
+  double total_extent = 0;
+  for (size_t i = 0; i < n_bodies; i++) {
+    body_handle_t handle =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    aabb_t aabb = broadphase->entries[handle.index].aabb;
+    total_extent += fmax(aabb.max.x - aabb.min.x, aabb.max.y - aabb.min.y);
+  }
+  double mean_extent = n_bodies > 0 ? total_extent / n_bodies : 0;
+  broadphase->cell_size = mean_extent > 0 ? GRID_CELL_SCALE * mean_extent : 1;
+
+  size_t n_insertions = 0;
+  for (size_t i = 0; i < n_bodies; i++) {
+    body_handle_t handle =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    broadphase_entry_t *entry = &broadphase->entries[handle.index];
+    int64_t max_x, max_y;
+    grid_cell_range(broadphase, entry->aabb, &entry->cell_min_x,
+                    &entry->cell_min_y, &max_x, &max_y);
+    double n_cells = (double)(max_x - entry->cell_min_x + 1) *
+                     (max_y - entry->cell_min_y + 1);
+    entry->oversized = n_cells > GRID_MAX_CELLS_PER_BODY;
+    if (!entry->oversized)
+      n_insertions += (size_t)n_cells;
+  }
+  grid_reserve(broadphase, n_insertions);
+
+  for (size_t i = 0; i < n_bodies; i++) {
+    body_handle_t handle =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    broadphase_entry_t *entry = &broadphase->entries[handle.index];
+    if (entry->oversized)
+      continue;
+    int64_t min_x, min_y, max_x, max_y;
+    grid_cell_range(broadphase, entry->aabb, &min_x, &min_y, &max_x, &max_y);
+    for (int64_t x = min_x; x <= max_x; x++) {
+      for (int64_t y = min_y; y <= max_y; y++)
+        grid_insert(broadphase, x, y, handle.index);
+    }
+  }
+}
+
+/**
+ * Reports each pair of bodies that share a grid cell and whose boxes overlap.
+ * Bodies sharing several cells are only reported from the first of them,
+ * where both of their ranges of cells start. Oversized bodies are tested
+ * against every other body instead.
+ */
+void broadphase_grid_find_pairs(broadphase_t *broadphase, list_t *bodies,
+                                broadphase_pair_found_t found, void *aux) {
+  for (size_t i = 0; i < broadphase->n_used_cells; i++) {
+    grid_cell_t *cell = &broadphase->cells[broadphase->used_cells[i]];
+    for (size_t a = cell->head; a != GRID_NODE_NONE;
+         a = broadphase->nodes[a].next) {
+      uint32_t slot1 = broadphase->nodes[a].slot;
+      broadphase_entry_t *entry1 = &broadphase->entries[slot1];
+      for (size_t b = broadphase->nodes[a].next; b != GRID_NODE_NONE;
+           b = broadphase->nodes[b].next) {
+        uint32_t slot2 = broadphase->nodes[b].slot;
+        broadphase_entry_t *entry2 = &broadphase->entries[slot2];
+        int64_t first_x = entry1->cell_min_x > entry2->cell_min_x
+                              ? entry1->cell_min_x
+                              : entry2->cell_min_x;
+        int64_t first_y = entry1->cell_min_y > entry2->cell_min_y
+                              ? entry1->cell_min_y
+                              : entry2->cell_min_y;
+        // Sharing a cell is not enough; keep only pairs whose boxes overlap
+        if (cell->x == first_x && cell->y == first_y &&
+            aabb_overlaps(entry1->aabb, entry2->aabb))
+          broadphase_report_pair(broadphase, slot1, slot2, found, aux);
+      }
+    }
+  }
+
+  size_t n_bodies = list_size(bodies);
+  for (size_t i = 0; i < n_bodies; i++) {
+    body_handle_t handle =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    broadphase_entry_t *entry = &broadphase->entries[handle.index];
+    if (!entry->oversized)
+      continue;
+    for (size_t j = 0; j < n_bodies; j++) {
+      body_handle_t other =
+          body_pool_get_handle(broadphase->pool, list_get(bodies, j));
+      broadphase_entry_t *other_entry = &broadphase->entries[other.index];
+      // Pairs of oversized bodies are reported from the earlier one
+      if (j == i || (other_entry->oversized && j < i))
+        continue;
+      if (aabb_overlaps(entry->aabb, other_entry->aabb))
+        broadphase_report_pair(broadphase, handle.index, other.index, found,
+                               aux);
+    }
+  }
+}
+
+/**
+ * Returns whether a body cannot move by itself: its mass is infinite and it
+ * is at rest. Such a body can still be moved explicitly.
+ */
+bool broadphase_body_is_static(body_t *body) {
+  vector_t velocity = body_get_velocity(body);
+  return body_get_mass(body) == INFINITY && velocity.x == 0 && velocity.y == 0;
+}
+
+/**
+ * Records the current bounding box of every body for this build.
+ */
+void broadphase_update_entries(broadphase_t *broadphase, list_t *bodies) {
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_t *body = list_get(bodies, i);
+    body_handle_t handle = body_pool_get_handle(broadphase->pool, body);
+    broadphase_entry_t *entry = broadphase_entry(broadphase, handle.index);
+    entry->aabb = body_get_aabb(body);
+    entry->generation = handle.generation;
+    entry->version = body_get_geometry_version(body);
+    entry->stamp = broadphase->stamp;
+    entry->oversized = false;
+    // A static body that was moved explicitly, or is new, may have started
+    // overlapping another static body, so it is treated as moving until
+    // pairs have been found with it in place
+    entry->is_static = broadphase_body_is_static(body) &&
+                       entry->found_generation == handle.generation &&
+                       entry->found_version == entry->version;
+  }
+}
+
+/**
+ * Orders endpoints by position, with minimums before maximums at the same
+ * position so that touching boxes count as overlapping.
+ */
+bool sap_endpoint_less(sap_endpoint_t a, sap_endpoint_t b) {
+  if (a.value != b.value)
+    return a.value < b.value;
+  return a.is_min && !b.is_min;
+}
+
+/**
+ * Brings the persistent x-axis endpoint list up to date with the bodies:
+ * drops the endpoints of bodies that are gone, refreshes the positions of
+ * the rest, and appends endpoints for new bodies.
+ */
+void sap_update_endpoints(broadphase_t *broadphase, list_t *bodies) {
+  size_t n_kept = 0;
+  for (size_t i = 0; i < broadphase->n_endpoints; i++) {
+    sap_endpoint_t endpoint = broadphase->endpoints[i];
+    broadphase_entry_t *entry = &broadphase->entries[endpoint.slot];
+    if (entry->stamp != broadphase->stamp ||
+        entry->sap_generation != entry->generation) {
+      // The body was removed, or its slot now holds a different body
+      entry->sap_generation = 0;
+      continue;
+    }
+    endpoint.value = endpoint.is_min ? entry->aabb.min.x : entry->aabb.max.x;
+    broadphase->endpoints[n_kept++] = endpoint;
+  }
+  broadphase->n_endpoints = n_kept;
+
+  size_t needed = n_kept + 2 * list_size(bodies);
+  if (needed > broadphase->endpoints_capacity) {
+    broadphase->endpoints =
+        realloc(broadphase->endpoints, sizeof(sap_endpoint_t) * needed);
+    broadphase->active =
+        realloc(broadphase->active, sizeof(uint32_t) * needed);
+    assert(broadphase->endpoints && broadphase->active);
+    broadphase->endpoints_capacity = needed;
+  }
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_handle_t handle =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    broadphase_entry_t *entry = &broadphase->entries[handle.index];
+    if (entry->sap_generation == handle.generation)
+      continue;
+    entry->sap_generation = handle.generation;
+    sap_endpoint_t min = {
+        .value = entry->aabb.min.x, .slot = handle.index, .is_min = true};
+    sap_endpoint_t max = {
+        .value = entry->aabb.max.x, .slot = handle.index, .is_min = false};
+    broadphase->endpoints[broadphase->n_endpoints++] = min;
+    broadphase->endpoints[broadphase->n_endpoints++] = max;
+  }
+}
+
+/**
+ * Brings the endpoints up to date and sorts them. The endpoints stay sorted
+ * between builds, and bodies only move a little each tick, so the insertion
+ * sort is close to linear.
+ */
+void broadphase_build_sap(broadphase_t *broadphase, list_t *bodies) {
+  sap_update_endpoints(broadphase, bodies);
+  sap_endpoint_t *endpoints = broadphase->endpoints;
+  for (size_t i = 1; i < broadphase->n_endpoints; i++) {
+    sap_endpoint_t endpoint = endpoints[i];
+    size_t j = i;
+    while (j > 0 && sap_endpoint_less(endpoint, endpoints[j - 1])) {
+      endpoints[j] = endpoints[j - 1];
+      j--;
+    }
+    endpoints[j] = endpoint;
+  }
+}
+
+/**
+ * Sweeps the sorted axis, keeping the bodies whose intervals are open,
+ * and reports each pair whose boxes overlap when the second of them opens.
+ */
+void broadphase_sap_find_pairs(broadphase_t *broadphase,
+                               broadphase_pair_found_t found, void *aux) {
+  sap_endpoint_t *endpoints = broadphase->endpoints;
+  size_t n_active = 0;
+  for (size_t i = 0; i < broadphase->n_endpoints; i++) {
+    uint32_t slot = endpoints[i].slot;
+    broadphase_entry_t *entry = &broadphase->entries[slot];
+    if (endpoints[i].is_min) {
+      for (size_t j = 0; j < n_active; j++) {
+        uint32_t other = broadphase->active[j];
+        if (aabb_overlaps(entry->aabb, broadphase->entries[other].aabb))
+          broadphase_report_pair(broadphase, slot, other, found, aux);
+      }
+      entry->sap_active_index = n_active;
+      broadphase->active[n_active++] = slot;
+    } else {
+      // Swap-remove the body from the active list
+      uint32_t last = broadphase->active[--n_active];
+      broadphase->active[entry->sap_active_index] = last;
+      broadphase->entries[last].sap_active_index = entry->sap_active_index;
+    }
+  }
+}
+
+aabb_tree_t *broadphase_entry_tree(broadphase_t *broadphase,
+                                   broadphase_entry_t *entry) {
+  return entry->tree_is_static ? broadphase->static_tree
+                               : broadphase->dynamic_tree;
+}
+
+/**
+ * Brings the trees up to date with the bodies. Proxies are fattened, so
+ * bodies that move a little keep their place in their tree.
+ */
+void broadphase_build_tree(broadphase_t *broadphase, list_t *bodies) {
+  for (size_t i = 0; i < broadphase->entries_capacity; i++) {
+    broadphase_entry_t *entry = &broadphase->entries[i];
+    if (entry->tree_generation != 0 &&
+        (entry->stamp != broadphase->stamp ||
+         entry->tree_generation != entry->generation)) {
+      // The body was removed, or its slot now holds a different body
+      aabb_tree_remove(broadphase_entry_tree(broadphase, entry),
+                       entry->tree_proxy);
+      entry->tree_generation = 0;
+    }
+  }
+
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_handle_t handle =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    broadphase_entry_t *entry = &broadphase->entries[handle.index];
+    if (entry->tree_generation != 0 &&
+        entry->tree_is_static == entry->is_static) {
+      aabb_tree_move(broadphase_entry_tree(broadphase, entry),
+                     entry->tree_proxy, entry->aabb);
+      continue;
+    }
+    if (entry->tree_generation != 0)
+      aabb_tree_remove(broadphase_entry_tree(broadphase, entry),
+                       entry->tree_proxy);
+    entry->tree_generation = handle.generation;
+    entry->tree_is_static = entry->is_static;
+    entry->tree_proxy =
+        aabb_tree_insert(broadphase_entry_tree(broadphase, entry), entry->aabb,
+                         handle.index);
+  }
+}
+
+typedef struct tree_pair_query {
+  broadphase_t *broadphase;
+  uint32_t slot;
+  // Set when querying the dynamic tree for a dynamic body, since each such
+  // pair is found from both of its bodies
+  bool skip_lower_slots;
+  broadphase_pair_found_t found;
+  void *aux;
+} tree_pair_query_t;
+
+void broadphase_tree_pair_found(void *aux, uint32_t other) {
+  tree_pair_query_t *query = (tree_pair_query_t *)aux;
+  broadphase_t *broadphase = query->broadphase;
+  if (other == query->slot || (query->skip_lower_slots && other < query->slot))
+    return;
+  // The proxies' boxes are fattened, so check the bodies' own boxes
+  if (aabb_overlaps(broadphase->entries[query->slot].aabb,
+                    broadphase->entries[other].aabb))
+    broadphase_report_pair(broadphase, query->slot, other, query->found,
+                           query->aux);
+}
+
+/**
+ * Queries the trees with each moving body's box and reports each pair whose
+ * boxes overlap. Pairs of static bodies are never visited.
+ */
+void broadphase_tree_find_pairs(broadphase_t *broadphase, list_t *bodies,
+                                broadphase_pair_found_t found, void *aux) {
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_handle_t handle =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    broadphase_entry_t *entry = &broadphase->entries[handle.index];
+    if (entry->is_static)
+      continue;
+    tree_pair_query_t query = {.broadphase = broadphase,
+                               .slot = handle.index,
+                               .skip_lower_slots = true,
+                               .found = found,
+                               .aux = aux};
+    aabb_tree_query(broadphase->dynamic_tree, entry->aabb,
+                    broadphase_tree_pair_found, &query);
+    query.skip_lower_slots = false;
+    aabb_tree_query(broadphase->static_tree, entry->aabb,
+                    broadphase_tree_pair_found, &query);
+  }
+}
+
+void broadphase_build(broadphase_t *broadphase, list_t *bodies) {
+  broadphase_next_stamp(broadphase);
+  broadphase_update_entries(broadphase, bodies);
+  switch (broadphase->kind) {
+  case BROADPHASE_GRID:
+    broadphase_build_grid(broadphase, bodies);
+    break;
+  case BROADPHASE_SAP:
+    broadphase_build_sap(broadphase, bodies);
+    break;
+  case BROADPHASE_TREE:
+    broadphase_build_tree(broadphase, bodies);
+    break;
+  case BROADPHASE_NONE:
+    break;
+  }
+  broadphase->is_valid = true;
+}
+
+/**
+ * Reports each pair of bodies whose boxes overlap by testing every pair.
+ */
+void broadphase_brute_force_find_pairs(broadphase_t *broadphase,
+                                       list_t *bodies,
+                                       broadphase_pair_found_t found,
+                                       void *aux) {
+  size_t n_bodies = list_size(bodies);
+  for (size_t i = 0; i < n_bodies; i++) {
+    body_handle_t handle1 =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    for (size_t j = i + 1; j < n_bodies; j++) {
+      body_handle_t handle2 =
+          body_pool_get_handle(broadphase->pool, list_get(bodies, j));
+      if (aabb_overlaps(broadphase->entries[handle1.index].aabb,
+                        broadphase->entries[handle2.index].aabb))
+        found(aux, handle1, handle2);
+    }
+  }
+}
+
+void broadphase_find_pairs(broadphase_t *broadphase, list_t *bodies,
+                           broadphase_pair_found_t found, void *aux) {
+  broadphase_build(broadphase, bodies);
+  switch (broadphase->kind) {
+  case BROADPHASE_GRID:
+    broadphase_grid_find_pairs(broadphase, bodies, found, aux);
+    break;
+  case BROADPHASE_SAP:
+    broadphase_sap_find_pairs(broadphase, found, aux);
+    break;
+  case BROADPHASE_TREE:
+    broadphase_tree_find_pairs(broadphase, bodies, found, aux);
+    break;
+  case BROADPHASE_NONE:
+    broadphase_brute_force_find_pairs(broadphase, bodies, found, aux);
+    break;
+  }
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_handle_t handle =
+        body_pool_get_handle(broadphase->pool, list_get(bodies, i));
+    broadphase_entry_t *entry = &broadphase->entries[handle.index];
+    entry->found_generation = entry->generation;
+    entry->found_version = entry->version;
+  }
+}
+
+typedef struct tree_region_query {
+  broadphase_t *broadphase;
+  aabb_t region;
+  list_t *result;
+} tree_region_query_t;
+
+void broadphase_tree_region_found(void *aux, uint32_t slot) {
+  tree_region_query_t *query = (tree_region_query_t *)aux;
+  broadphase_entry_t *entry = &query->broadphase->entries[slot];
+  body_handle_t handle = {.index = slot, .generation = entry->generation};
+  body_t *body = body_pool_resolve(query->broadphase->pool, handle);
+  if (body == NULL)
+    return;
+  aabb_t aabb = entry->version == body_get_geometry_version(body)
+                    ? entry->aabb
+                    : body_get_aabb(body);
+  if (aabb_overlaps(aabb, query->region))
+    list_add(query->result, body);
+}
+
+void broadphase_query_region(broadphase_t *broadphase, list_t *bodies,
+                             aabb_t region, list_t *result) {
+  if (broadphase->kind != BROADPHASE_TREE) {
+    for (size_t i = 0; i < list_size(bodies); i++) {
+      body_t *body = list_get(bodies, i);
+      if (aabb_overlaps(body_get_aabb(body), region))
+        list_add(result, body);
+    }
+    return;
+  }
+  if (!broadphase->is_valid)
+    broadphase_build(broadphase, bodies);
+  tree_region_query_t query = {
+      .broadphase = broadphase, .region = region, .result = result};
+  aabb_tree_query(broadphase->static_tree, region,
+                  broadphase_tree_region_found, &query);
+  aabb_tree_query(broadphase->dynamic_tree, region,
+                  broadphase_tree_region_found, &query);
+}
@@ -1,4 +1,5 @@
 #include "collision.h"
+#include "gjk.h"
 #include "list.h"
 #include "math.h"
 #include "polygon.h"
@@ -13,149 +14,643 @@
 #include <unistd.h>
 
 const vector_t ZERO_VEC = {.x = 0, .y = 0};
+// Shapes with more polygon vertices than this between them are tested with
+// GJK and EPA, whose cost grows linearly in the vertices rather than
+// quadratically like the separating axis tests
+const size_t GJK_VERTEX_THRESHOLD = 40;
+// Convex polygons with more vertices than this are projected by
+// hill-climbing, which beats visiting every vertex once it skips enough
+const size_t HILL_CLIMB_MIN_VERTICES = 24;
 
-typedef struct line {
-  vector_t point1;
-  vector_t point2;
-} line_t;
+/**
+ * Projects a polygon onto a unit axis by its extreme vertices along it.
+ * A convex polygon with enough vertices has them found by hill-climbing
+ * (see polygon_find_extreme()); any other polygon has every vertex projected.
+ * Returns the smallest projection as x and the largest as y.
+ */
+vector_t project_shape(shape_view_t shape, vector_t axis) {
+  if (shape.extreme_hints != NULL && shape.size > HILL_CLIMB_MIN_VERTICES) {
+    size_t min = polygon_find_extreme(shape, vec_negate(axis));
+    size_t max = polygon_find_extreme(shape, axis);
+    vector_t result = {.x = vec_dot(shape.points[min], axis),
+                       .y = vec_dot(shape.points[max], axis)};
+    return result;
+  }
+  double min = shape.points[0].x * axis.x + shape.points[0].y * axis.y;
+  double max = min;
+  for (size_t i = 1; i < shape.size; i++) {
+    double value = shape.points[i].x * axis.x + shape.points[i].y * axis.y;
+    if (value < min)
+      min = value;
+    if (value > max)
+      max = value;
+  }
+  vector_t result = {.x = min, .y = max};
+  return result;
+}
+
+/**
+ * Returns whether a view is of a rectangle whose half_extents are known.
+ */
+bool shape_is_box(shape_view_t shape) {
+  return shape.normals != NULL && shape.half_extents.x > 0;
+}
+
+/**
+ * Projects a rectangle onto a unit axis from its center and half-widths,
+ * without visiting its vertices.
+ * Returns the smallest projection as x and the largest as y.
+ */
+vector_t project_box(shape_view_t box, vector_t axis) {
+  double center = box.center.x * axis.x + box.center.y * axis.y;
+  double radius =
+      box.half_extents.x *
+          fabs(box.normals[0].x * axis.x + box.normals[0].y * axis.y) +
+      box.half_extents.y *
+          fabs(box.normals[1].x * axis.x + box.normals[1].y * axis.y);
+  vector_t result = {.x = center - radius, .y = center + radius};
+  return result;
+}
+
+/**
+ * Projects a polygon onto a unit axis, using its extents if it is a rectangle.
+ */
+vector_t project_polygon(shape_view_t shape, vector_t axis) {
+  return shape_is_box(shape) ? project_box(shape, axis)
+                             : project_shape(shape, axis);
+}
+
+/**
+ * Gets how far two projections, each given as its least value as x and its
+ * greatest as y, overlap, or 0 if they only touch or are apart.
+ * Projections sharing an end, like those of boxes of equal widths, still
+ * overlap.
+ */
+double overlaps(vector_t v1, vector_t v2) {
+  double overlap = fmin(v1.y, v2.y) - fmax(v1.x, v2.x);
+  return overlap > 0 ? overlap : 0;
+}
+
+bool aabb_overlaps(aabb_t box1, aabb_t box2) {
+  return box1.min.x <= box2.max.x && box2.min.x <= box1.max.x &&
+         box1.min.y <= box2.max.y && box2.min.y <= box1.max.y;
+}
+
+bool collision_get_collided(collision_info_t collision) {
+  return collision.collided;
+}
 
-void line_freer(void *to_free) {
-  line_t *line = (line_t *)to_free;
-  free(line);
+vector_t collision_get_axis(collision_info_t collision) {
+  return collision.axis;
+}
+
+double collision_get_depth(collision_info_t collision) {
+  return collision.depth;
 }
 
-line_t *line_init(vector_t point1, vector_t point2) {
-  line_t *result = malloc(sizeof(line_t));
-  result->point1 = point1;
-  result->point2 = point2;
+/**
+ * Tests the shapes along the normal of each edge of one of them,
+ * using the normals cached in the view if it has them.
+ * A rectangle's last two normals are opposites of its first two,
+ * so only those are tested.
+ * Keeps the axis with the least overlap seen so far in min_overlap and
+ * min_axis, and returns false as soon as the shapes are separated.
+ */
+bool test_edge_normals(shape_view_t edges, shape_view_t shape1,
+                       shape_view_t shape2, double *min_overlap,
+                       vector_t *min_axis) {
+  size_t n_axes = shape_is_box(edges) ? 2 : edges.size;
+  for (size_t i = 0; i < n_axes; i++) {
+    vector_t axis = edges.normals != NULL
+                        ? edges.normals[i]
+                        : polygon_edge_normal(edges.points[i],
+                                              edges.points[(i + 1) % edges.size]);
+    double overlap =
+        overlaps(project_polygon(shape1, axis), project_polygon(shape2, axis));
+    if (!overlap)
+      return false;
+    if (overlap < *min_overlap) {
+      *min_overlap = overlap;
+      *min_axis = axis;
+    }
+  }
+  return true;
+}
+
+/**
+ * Tests two circles by the distance between their centers.
+ * Circles that only touch are not colliding, like polygons under overlaps().
+ */
+collision_info_t find_collision_circles(shape_view_t circle1,
+                                        shape_view_t circle2) {
+  double dx = circle2.center.x - circle1.center.x;
+  double dy = circle2.center.y - circle1.center.y;
+  double distance_squared = dx * dx + dy * dy;
+  double radii = circle1.radius + circle2.radius;
+  if (!(distance_squared < radii * radii)) {
+    collision_info_t result = {.collided = false, .axis = ZERO_VEC};
+    return result;
+  }
+  double distance = sqrt(distance_squared);
+  // Concentric circles can be pushed apart along any axis
+  vector_t axis = {.x = 0, .y = 1};
+  if (distance > 0) {
+    axis.x = dx / distance;
+    axis.y = dy / distance;
+  }
+  collision_info_t result = {.collided = true, .axis = axis};
   return result;
 }
 
-line_t *get_perpendicular_line(line_t *line) {
-  vector_t point1 = line->point1;
-  vector_t point2 = line->point2;
-  vector_t midpoint = {.x = (point1.x + point2.x) / 2,
-                       .y = (point1.y + point2.y) / 2};
-  vector_t new_point1 = vec_rotate_point(point1, M_PI / 2, midpoint);
-  vector_t new_point2 = vec_rotate_point(point2, M_PI / 2, midpoint);
-  line_t *result = line_init(new_point1, new_point2);
+/**
+ * Projects a circle onto a unit axis.
+ * Returns the smallest projection as x and the largest as y.
+ */
+vector_t project_circle(shape_view_t circle, vector_t axis) {
+  double center = circle.center.x * axis.x + circle.center.y * axis.y;
+  vector_t result = {.x = center - circle.radius, .y = center + circle.radius};
   return result;
 }
 
-list_t *shape_perpendicular_lines(list_t *shape) {
-  list_t *lines = list_init(list_size(shape), line_freer);
-  for (size_t i = 1; i <= list_size(shape); i++) {
-    vector_t point1 = *(vector_t *)list_get(shape, i - 1);
-    vector_t point2 = *(vector_t *)list_get(shape, i % list_size(shape));
-    line_t *line = line_init(point1, point2);
-    assert(line);
-    line_t *perp_line = get_perpendicular_line(line);
-    assert(perp_line);
-    free(line);
-    list_add(lines, perp_line);
+/**
+ * Tests a circle against a convex polygon. The only separating axes to
+ * check are the polygon's edge normals and the axis from the polygon's
+ * closest vertex to the circle's center.
+ * A rectangle needs only two edge normals, and its closest vertex is
+ * the corner on the circle's side of both of them.
+ */
+collision_info_t find_collision_circle_polygon(shape_view_t shape1,
+                                               shape_view_t shape2) {
+  bool circle_first = shape1.radius > 0;
+  shape_view_t circle = circle_first ? shape1 : shape2;
+  shape_view_t polygon = circle_first ? shape2 : shape1;
+  collision_info_t no_collision = {.collided = false, .axis = ZERO_VEC};
+
+  double min_overlap = INFINITY;
+  vector_t min_axis = ZERO_VEC;
+  bool is_box = shape_is_box(polygon);
+  size_t n_axes = is_box ? 2 : polygon.size;
+  double min_distance_squared = INFINITY;
+  vector_t closest = polygon.points[0];
+  for (size_t i = 0; i < n_axes; i++) {
+    vector_t axis = polygon.normals != NULL
+                        ? polygon.normals[i]
+                        : polygon_edge_normal(
+                              polygon.points[i],
+                              polygon.points[(i + 1) % polygon.size]);
+    vector_t circle_range = project_circle(circle, axis);
+    vector_t polygon_range = project_polygon(polygon, axis);
+    double overlap = circle_first ? overlaps(circle_range, polygon_range)
+                                  : overlaps(polygon_range, circle_range);
+    if (!overlap)
+      return no_collision;
+    if (overlap < min_overlap) {
+      min_overlap = overlap;
+      min_axis = axis;
+    }
+    if (is_box)
+      continue;
+    double dx = circle.center.x - polygon.points[i].x;
+    double dy = circle.center.y - polygon.points[i].y;
+    if (dx * dx + dy * dy < min_distance_squared) {
+      min_distance_squared = dx * dx + dy * dy;
+      closest = polygon.points[i];
+    }
+  }
+  if (is_box) {
+    vector_t offset = {.x = circle.center.x - polygon.center.x,
+                       .y = circle.center.y - polygon.center.y};
+    double hx = polygon.half_extents.x;
+    double hy = polygon.half_extents.y;
+    if (offset.x * polygon.normals[0].x + offset.y * polygon.normals[0].y < 0)
+      hx = -hx;
+    if (offset.x * polygon.normals[1].x + offset.y * polygon.normals[1].y < 0)
+      hy = -hy;
+    closest.x = polygon.center.x + hx * polygon.normals[0].x +
+                hy * polygon.normals[1].x;
+    closest.y = polygon.center.y + hx * polygon.normals[0].y +
+                hy * polygon.normals[1].y;
+    double dx = circle.center.x - closest.x;
+    double dy = circle.center.y - closest.y;
+    min_distance_squared = dx * dx + dy * dy;
   }
-  return lines;
+
+  // A center exactly on a vertex gives no axis, but the edge normals suffice
+  if (min_distance_squared > 0) {
+    double distance = sqrt(min_distance_squared);
+    vector_t axis = {.x = (circle.center.x - closest.x) / distance,
+                     .y = (circle.center.y - closest.y) / distance};
+    vector_t circle_range = project_circle(circle, axis);
+    vector_t polygon_range = project_polygon(polygon, axis);
+    double overlap = circle_first ? overlaps(circle_range, polygon_range)
+                                  : overlaps(polygon_range, circle_range);
+    if (!overlap)
+      return no_collision;
+    if (overlap < min_overlap)
+      min_axis = axis;
+  }
+
+  collision_info_t result = {.collided = true, .axis = min_axis};
+  return result;
 }
 
-vector_t line_get_unit_vector(line_t *line) {
-  vector_t point1 = line->point1;
-  vector_t point2 = line->point2;
-  vector_t temp = vec_subtract(point2, point1);
-  vector_t unit_vector = vec_normalize(temp);
-  return unit_vector;
+/**
+ * Projects any shape onto a unit axis, as a circle, rectangle or polygon.
+ */
+vector_t project_view(shape_view_t shape, vector_t axis) {
+  return shape.radius > 0 ? project_circle(shape, axis)
+                          : project_polygon(shape, axis);
 }
 
-double project_vertex_onto_line(line_t *line, vector_t vertex) {
-  vector_t unit_vector = line_get_unit_vector(line);
-  double length = vec_dot(vertex, unit_vector);
-  return length;
+/**
+ * Keeps the part of the segment from point1 to point2 where
+ * the projection onto direction is at least offset.
+ * Stores the endpoints of the part in result and returns how many there are.
+ */
+size_t clip_segment(vector_t point1, vector_t point2, vector_t direction,
+                    double offset, vector_t *result) {
+  double distance1 = vec_dot(point1, direction) - offset;
+  double distance2 = vec_dot(point2, direction) - offset;
+  size_t n_points = 0;
+  if (distance1 >= 0)
+    result[n_points++] = point1;
+  if (distance2 >= 0)
+    result[n_points++] = point2;
+  if (distance1 * distance2 < 0) {
+    double t = distance1 / (distance1 - distance2);
+    result[n_points].x = point1.x + t * (point2.x - point1.x);
+    result[n_points].y = point1.y + t * (point2.y - point1.y);
+    n_points++;
+  }
+  return n_points;
 }
 
-vector_t project_polygon_onto_line(list_t *shape, line_t *line) {
-  vector_t vertex1 = *(vector_t *)list_get(shape, 0);
-  double value1 = project_vertex_onto_line(line, vertex1);
-  double max = value1;
-  double min = value1;
-  for (size_t i = 0; i < list_size(shape); i++) {
-    vector_t vertex = *(vector_t *)list_get(shape, i);
-    double value = project_vertex_onto_line(line, vertex);
-    if (value < min)
-      min = value;
-    if (value > max)
+/**
+ * Finds the edge of a polygon that faces furthest along a unit axis:
+ * of the two edges at the vertex that projects furthest, the one more
+ * perpendicular to the axis. Stores its endpoints in start and end.
+ */
+void find_best_edge(shape_view_t shape, vector_t axis, vector_t *start,
+                    vector_t *end) {
+  size_t best = 0;
+  double max = vec_dot(shape.points[0], axis);
+  for (size_t i = 1; i < shape.size; i++) {
+    double value = vec_dot(shape.points[i], axis);
+    if (value > max) {
       max = value;
+      best = i;
+    }
+  }
+  vector_t vertex = shape.points[best];
+  vector_t next = shape.points[(best + 1) % shape.size];
+  vector_t prev = shape.points[(best + shape.size - 1) % shape.size];
+  vector_t from_prev = vec_normalize(vec_subtract(vertex, prev));
+  vector_t from_next = vec_normalize(vec_subtract(vertex, next));
+  if (vec_dot(from_prev, axis) <= vec_dot(from_next, axis)) {
+    *start = prev;
+    *end = vertex;
+  } else {
+    *start = vertex;
+    *end = next;
   }
-  vector_t result = {.x = min, .y = max};
-  return result;
 }
 
-double overlaps(vector_t v1, vector_t v2) {
-  double min1 = v1.x;
-  double min2 = v2.x;
-  double max1 = v1.y;
-  double max2 = v2.y;
-  if (min1 < min2 && max1 > min2 && max2 > max1) {
-    return (max1 - min2);
+/**
+ * Finds the points where two colliding polygons touch, given the axis from
+ * the first towards the second. The edge of one polygon facing the other
+ * that is more perpendicular to the axis is the reference edge; the other
+ * polygon's facing edge is clipped to the reference edge's extent, and the
+ * clipped points behind the reference edge are the contacts.
+ * Returns the number of contacts stored.
+ */
+size_t find_polygon_contacts(shape_view_t shape1, shape_view_t shape2,
+                             vector_t axis, vector_t *contacts) {
+  vector_t start1, end1, start2, end2;
+  find_best_edge(shape1, axis, &start1, &end1);
+  find_best_edge(shape2, vec_negate(axis), &start2, &end2);
+  vector_t edge1 = vec_normalize(vec_subtract(end1, start1));
+  vector_t edge2 = vec_normalize(vec_subtract(end2, start2));
+  bool first_is_reference =
+      fabs(vec_dot(edge1, axis)) <= fabs(vec_dot(edge2, axis));
+  vector_t ref_start = first_is_reference ? start1 : start2;
+  vector_t ref_end = first_is_reference ? end1 : end2;
+  vector_t ref_edge = first_is_reference ? edge1 : edge2;
+  vector_t incident_start = first_is_reference ? start2 : start1;
+  vector_t incident_end = first_is_reference ? end2 : end1;
+  // The reference edge's normal points away from its polygon
+  vector_t outward = first_is_reference ? axis : vec_negate(axis);
+
+  vector_t clipped[3];
+  vector_t clipped_again[3];
+  if (clip_segment(incident_start, incident_end, ref_edge,
+                   vec_dot(ref_edge, ref_start), clipped) < 2 ||
+      clip_segment(clipped[0], clipped[1], vec_negate(ref_edge),
+                   -vec_dot(ref_edge, ref_end), clipped_again) < 2) {
+    // The edges barely overlap, so fall back to the incident edge's
+    // endpoint nearest the reference polygon
+    contacts[0] = vec_dot(incident_start, outward) <
+                          vec_dot(incident_end, outward)
+                      ? incident_start
+                      : incident_end;
+    return 1;
   }
-  if (min1 < min2 && max1 > min2 && max2 < max1) {
-    return (max2 - min2);
+  vector_t normal = {.x = -ref_edge.y, .y = ref_edge.x};
+  if (vec_dot(normal, outward) < 0)
+    normal = vec_negate(normal);
+  double face = vec_dot(normal, ref_start);
+  size_t n_contacts = 0;
+  for (size_t i = 0; i < 2; i++) {
+    if (vec_dot(normal, clipped_again[i]) <= face)
+      contacts[n_contacts++] = clipped_again[i];
   }
-  if (min2 < min1 && max2 > min1 && max1 > max2) {
-    return (max2 - min1);
+  if (n_contacts == 0) {
+    contacts[0] = vec_dot(clipped_again[0], normal) <
+                          vec_dot(clipped_again[1], normal)
+                      ? clipped_again[0]
+                      : clipped_again[1];
+    n_contacts = 1;
   }
-  if (min2 < min1 && max2 > min1 && max1 < max2) {
-    return (max1 - min1);
+  return n_contacts;
+}
+
+/**
+ * Completes the collision of two shapes known to collide along an axis:
+ * orients the axis from the first shape towards the second,
+ * and finds the penetration depth and contact points.
+ */
+collision_info_t collision_from_axis(shape_view_t shape1, shape_view_t shape2,
+                                     vector_t axis) {
+  vector_t range1 = project_view(shape1, axis);
+  vector_t range2 = project_view(shape2, axis);
+  if (range2.x + range2.y < range1.x + range1.y) {
+    axis = vec_negate(axis);
+    range1 = (vector_t){.x = -range1.y, .y = -range1.x};
+    range2 = (vector_t){.x = -range2.y, .y = -range2.x};
+  }
+  collision_info_t result = {
+      .collided = true, .axis = axis, .depth = range1.y - range2.x};
+  // A circle touches the other shape at its deepest point
+  if (shape2.radius > 0) {
+    result.contacts[0] = vec_subtract(shape2.center,
+                                      vec_multiply(shape2.radius, axis));
+    result.n_contacts = 1;
+  } else if (shape1.radius > 0) {
+    result.contacts[0] =
+        vec_add(shape1.center, vec_multiply(shape1.radius, axis));
+    result.n_contacts = 1;
   } else {
-    return 0;
+    result.n_contacts =
+        find_polygon_contacts(shape1, shape2, axis, result.contacts);
   }
+  return result;
 }
 
-bool collision_get_collided(collision_info_t collision) {
-  return collision.collided;
+/**
+ * Counts the vertices of a shape that the separating axis tests project,
+ * of which a circle has none.
+ */
+size_t view_vertex_count(shape_view_t shape) {
+  return shape.radius > 0 ? 0 : shape.size;
 }
 
-vector_t collision_get_axis(collision_info_t collision) {
-  return collision.axis;
+/**
+ * Tests two shapes with GJK and EPA (see gjk_find_axis()).
+ * Returns false if that could not decide, so the shapes must be tested with
+ * separating axes instead.
+ */
+bool find_collision_gjk(shape_view_t shape1, shape_view_t shape2,
+                        collision_info_t *result) {
+  vector_t axis = ZERO_VEC;
+  gjk_result_t gjk = gjk_find_axis(shape1, shape2, &axis);
+  if (gjk == GJK_DEGENERATE)
+    return false;
+  // Shapes that only touch along the axis are not colliding, as with
+  // overlaps() in the separating axis tests
+  result->collided =
+      gjk == GJK_OVERLAPPING &&
+      overlaps(project_view(shape1, axis), project_view(shape2, axis)) > 0;
+  result->axis = axis;
+  return true;
 }
 
-collision_info_t find_collision(list_t *shape1, list_t *shape2) {
-  list_t *perp_lines1 = shape_perpendicular_lines(shape1);
-  list_t *perp_lines2 = shape_perpendicular_lines(shape2);
-  double min_overlap = INFINITY;
-  vector_t min_axis = ZERO_VEC;
-  for (size_t i = 0; i < list_size(perp_lines1); i++) {
-    line_t *current_line = list_get(perp_lines1, i);
-    vector_t mm1 = project_polygon_onto_line(shape1, current_line);
-    vector_t mm2 = project_polygon_onto_line(shape2, current_line);
-    if (!overlaps(mm1, mm2)) {
-      list_free(perp_lines1);
-      list_free(perp_lines2);
-      collision_info_t result = {.collided = false, .axis = ZERO_VEC};
-      return result;
-    }
-    if (overlaps(mm1, mm2) < min_overlap) {
-      min_overlap = overlaps(mm1, mm2);
-      min_axis = line_get_unit_vector(current_line);
-    }
+collision_info_t find_collision_view(shape_view_t shape1, shape_view_t shape2) {
+  collision_info_t result;
+  if (shape1.radius > 0 && shape2.radius > 0) {
+    result = find_collision_circles(shape1, shape2);
+  } else if (view_vertex_count(shape1) + view_vertex_count(shape2) >
+                 GJK_VERTEX_THRESHOLD &&
+             find_collision_gjk(shape1, shape2, &result)) {
+    // find_collision_gjk() has filled in result
+  } else if (shape1.radius > 0 || shape2.radius > 0) {
+    result = find_collision_circle_polygon(shape1, shape2);
+  } else {
+    double min_overlap = INFINITY;
+    vector_t min_axis = ZERO_VEC;
+    result.collided =
+        test_edge_normals(shape1, shape1, shape2, &min_overlap, &min_axis) &&
+        test_edge_normals(shape2, shape1, shape2, &min_overlap, &min_axis);
+    result.axis = min_axis;
+  }
+  if (!result.collided) {
+    collision_info_t no_collision = {.collided = false, .axis = ZERO_VEC};
+    return no_collision;
+  }
+  return collision_from_axis(shape1, shape2, result.axis);
+}
+
+/**
+ * Narrows [*enter, *exit] to the fractions of a motion at which the
+ * projections of two shapes onto an axis overlap, where shape1 ends the
+ * motion at its view after moving by displacement.
+ * Returns false if the range becomes empty, i.e. the axis separates the
+ * shapes throughout it.
+ */
+bool sweep_axis(shape_view_t shape1, vector_t displacement,
+                shape_view_t shape2, vector_t axis, double *enter,
+                double *exit) {
+  vector_t range1 = project_view(shape1, axis);
+  vector_t range2 = project_view(shape2, axis);
+  double speed = displacement.x * axis.x + displacement.y * axis.y;
+  // At fraction t, shape1's range is offset by (t - 1) * speed,
+  // and the ranges overlap while that offset is between low and high
+  double low = range2.x - range1.y;
+  double high = range2.y - range1.x;
+  if (speed == 0)
+    return low < 0 && high > 0;
+  double time1 = 1 + low / speed;
+  double time2 = 1 + high / speed;
+  *enter = fmax(*enter, fmin(time1, time2));
+  *exit = fmin(*exit, fmax(time1, time2));
+  return *enter < *exit;
+}
+
+/**
+ * Sweeps the shapes along the normal of each edge of one of them,
+ * as in test_edge_normals().
+ */
+bool sweep_edge_normals(shape_view_t edges, shape_view_t shape1,
+                        vector_t displacement, shape_view_t shape2,
+                        double *enter, double *exit) {
+  size_t n_axes = shape_is_box(edges) ? 2 : edges.size;
+  for (size_t i = 0; i < n_axes; i++) {
+    vector_t axis = edges.normals != NULL
+                        ? edges.normals[i]
+                        : polygon_edge_normal(edges.points[i],
+                                              edges.points[(i + 1) % edges.size]);
+    if (!sweep_axis(shape1, displacement, shape2, axis, enter, exit))
+      return false;
   }
-  for (size_t i = 0; i < list_size(perp_lines2); i++) {
-    line_t *current_line = list_get(perp_lines2, i);
-    vector_t mm1 = project_polygon_onto_line(shape1, current_line);
-    vector_t mm2 = project_polygon_onto_line(shape2, current_line);
-    if (!overlaps(mm1, mm2)) {
-      list_free(perp_lines1);
-      list_free(perp_lines2);
-      collision_info_t result = {.collided = false, .axis = ZERO_VEC};
-      return result;
+  return true;
+}
+
+/**
+ * Finds when two circles first overlap by solving for the distance between
+ * their centers along the motion.
+ */
+double find_time_of_impact_circles(shape_view_t circle1, vector_t displacement,
+                                   shape_view_t circle2) {
+  // The offset between the centers at fraction t is offset + (t - 1) * d
+  vector_t offset = {.x = circle1.center.x - circle2.center.x,
+                     .y = circle1.center.y - circle2.center.y};
+  double radii = circle1.radius + circle2.radius;
+  double a = displacement.x * displacement.x + displacement.y * displacement.y;
+  double b = offset.x * displacement.x + offset.y * displacement.y;
+  double c = offset.x * offset.x + offset.y * offset.y - radii * radii;
+  if (a == 0)
+    return c < 0 ? 0 : INFINITY;
+  double discriminant = b * b - a * c;
+  if (discriminant <= 0)
+    return INFINITY;
+  double root = sqrt(discriminant);
+  double enter = 1 + (-b - root) / a;
+  double exit = 1 + (-b + root) / a;
+  if (enter >= 1 || exit <= 0)
+    return INFINITY;
+  return fmax(enter, 0);
+}
+
+/**
+ * Finds the earliest fraction of a motion at which a point moving from start
+ * by motion comes within radius of a fixed point, or INFINITY if it does not.
+ */
+double point_time_of_impact(vector_t start, vector_t motion, vector_t point,
+                            double radius) {
+  vector_t offset = {.x = start.x - point.x, .y = start.y - point.y};
+  double a = motion.x * motion.x + motion.y * motion.y;
+  double b = offset.x * motion.x + offset.y * motion.y;
+  double c = offset.x * offset.x + offset.y * offset.y - radius * radius;
+  double discriminant = b * b - a * c;
+  if (a == 0 || discriminant <= 0)
+    return INFINITY;
+  double time = (-b - sqrt(discriminant)) / a;
+  return time >= 0 && time <= 1 ? time : INFINITY;
+}
+
+/**
+ * Finds when a circle whose center moves from start by motion first overlaps
+ * a fixed convex polygon. The center must come within the radius of an edge,
+ * so it enters either the band along an edge's outer side or the disc around
+ * a vertex.
+ */
+double find_time_of_impact_circle_polygon(vector_t start, vector_t motion,
+                                          double radius,
+                                          shape_view_t polygon) {
+  // The mean of the vertices is inside, so it orients the edge normals
+  vector_t inside = ZERO_VEC;
+  for (size_t i = 0; i < polygon.size; i++) {
+    inside.x += polygon.points[i].x / polygon.size;
+    inside.y += polygon.points[i].y / polygon.size;
+  }
+  bool contains_start = true;
+  double min_distance_squared = INFINITY;
+  double result = INFINITY;
+  for (size_t i = 0; i < polygon.size; i++) {
+    vector_t point1 = polygon.points[i];
+    vector_t point2 = polygon.points[(i + 1) % polygon.size];
+    vector_t normal = polygon_edge_normal(point1, point2);
+    if (normal.x * (inside.x - point1.x) + normal.y * (inside.y - point1.y) >
+        0) {
+      normal.x = -normal.x;
+      normal.y = -normal.y;
     }
-    if (overlaps(mm1, mm2) < min_overlap) {
-      min_overlap = overlaps(mm1, mm2);
-      min_axis = line_get_unit_vector(current_line);
+    vector_t edge = {.x = point2.x - point1.x, .y = point2.y - point1.y};
+    vector_t offset = {.x = start.x - point1.x, .y = start.y - point1.y};
+    double edge_squared = edge.x * edge.x + edge.y * edge.y;
+    double distance = normal.x * offset.x + normal.y * offset.y;
+    if (distance > 0)
+      contains_start = false;
+    // Track how far the start is from the edge, to catch a circle that
+    // already overlaps the polygon
+    double along = fmin(
+        fmax((offset.x * edge.x + offset.y * edge.y) / edge_squared, 0), 1);
+    double dx = offset.x - along * edge.x;
+    double dy = offset.y - along * edge.y;
+    min_distance_squared = fmin(min_distance_squared, dx * dx + dy * dy);
+
+    double speed = normal.x * motion.x + normal.y * motion.y;
+    if (distance >= radius && speed < 0) {
+      double time = (radius - distance) / speed;
+      double hit_along = ((offset.x + time * motion.x) * edge.x +
+                          (offset.y + time * motion.y) * edge.y) /
+                         edge_squared;
+      if (time <= 1 && hit_along >= 0 && hit_along <= 1)
+        result = fmin(result, time);
     }
+    result =
+        fmin(result, point_time_of_impact(start, motion, point1, radius));
   }
-  if (perp_lines2 != NULL)
-    list_free(perp_lines2);
-  if (perp_lines1 != NULL)
-    list_free(perp_lines1);
-  collision_info_t result = {.collided = true, .axis = min_axis};
+  if (contains_start || min_distance_squared < radius * radius)
+    return 0;
+  return result;
+}
+
+double find_time_of_impact(shape_view_t shape1, vector_t displacement,
+                           shape_view_t shape2) {
+  if (shape1.radius > 0 && shape2.radius > 0)
+    return find_time_of_impact_circles(shape1, displacement, shape2);
+  // Sweep the circle's center relative to the polygon where it ended up
+  if (shape1.radius > 0) {
+    vector_t start = {.x = shape1.center.x - displacement.x,
+                      .y = shape1.center.y - displacement.y};
+    return find_time_of_impact_circle_polygon(start, displacement,
+                                              shape1.radius, shape2);
+  }
+  if (shape2.radius > 0) {
+    vector_t start = {.x = shape2.center.x + displacement.x,
+                      .y = shape2.center.y + displacement.y};
+    return find_time_of_impact_circle_polygon(
+        start, vec_negate(displacement), shape2.radius, shape1);
+  }
+  double enter = 0;
+  double exit = 1;
+  if (!sweep_edge_normals(shape1, shape1, displacement, shape2, &enter,
+                          &exit) ||
+      !sweep_edge_normals(shape2, shape1, displacement, shape2, &enter,
+                          &exit))
+    return INFINITY;
+  return enter;
+}
+
+/**
+ * Copies a list of vertices into a newly allocated contiguous array
+ * and returns a view of it. The array must be freed by the caller.
+ */
+shape_view_t view_from_list(list_t *shape) {
+  size_t size = list_size(shape);
+  vector_t *points = malloc(sizeof(vector_t) * size);
+  assert(points);
+  for (size_t i = 0; i < size; i++) {
+    points[i] = *(vector_t *)list_get(shape, i);
+  }
+  shape_view_t result = {.points = points, .size = size};
+  return result;
+}
+
+collision_info_t find_collision(list_t *shape1, list_t *shape2) {
+  shape_view_t view1 = view_from_list(shape1);
+  shape_view_t view2 = view_from_list(shape2);
+  collision_info_t result = find_collision_view(view1, view2);
+  free((vector_t *)view1.points);
+  free((vector_t *)view2.points);
   return result;
 }
\ No newline at end of file
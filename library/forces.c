@@ -44,27 +44,20 @@ typedef enum {
 } sound_t;
 
 typedef struct two_body_aux {
-  body_t *body1;
-  body_t *body2;
+  scene_t *scene;
+  body_handle_t body1;
+  body_handle_t body2;
   double constant;
 } two_body_aux_t;
 
 typedef struct one_body_aux {
-  body_t *body;
+  scene_t *scene;
+  body_handle_t body;
   double constant;
 } one_body_aux_t;
 
-typedef struct collision_aux {
-  body_t *body1;
-  body_t *body2;
-  collision_handler_t handler;
-  free_func_t aux_freer;
-  bool is_colliding;
-  void *aux;
-  bool hold_colliding; // true when the force should be applied multiple times (if is_collision is true)
-} collision_aux_t;
-
 typedef struct bodies_collision_aux {
+  scene_t *scene;
   list_t *bodies;
   bodies_collision_handler_t handler;
   free_func_t aux_freer;
@@ -73,14 +66,6 @@ typedef struct bodies_collision_aux {
   bool hold_colliding; // true when the force should be applied multiple times (if is_collision is true)
 } bodies_collision_aux_t;
 
-void collision_aux_freer(void *collision_aux) {
-  collision_aux_t *ca = (collision_aux_t *)collision_aux;
-  assert(ca);
-  if (ca->aux_freer != NULL)
-    ca->aux_freer(ca->aux);
-  free(ca);
-}
-
 void two_body_aux_freer(void *two_body_aux) {
   two_body_aux_t *tba = (two_body_aux_t *)two_body_aux;
   assert(tba);
@@ -93,39 +78,27 @@ void one_body_aux_freer(void *one_body_aux) {
   free(oba);
 }
 
-two_body_aux_t *two_body_aux_init(body_t *body1, body_t *body2,
-                                  double constant) {
+two_body_aux_t *two_body_aux_init(scene_t *scene, body_t *body1,
+                                  body_t *body2, double constant) {
   two_body_aux_t *result = malloc(sizeof(two_body_aux_t));
   assert(result);
-  result->body1 = body1;
-  result->body2 = body2;
+  result->scene = scene;
+  result->body1 = scene_reserve_body_handle(scene, body1);
+  result->body2 = scene_reserve_body_handle(scene, body2);
   result->constant = constant;
   return result;
 }
 
-one_body_aux_t *one_body_aux_init(body_t *body, double constant) {
+one_body_aux_t *one_body_aux_init(scene_t *scene, body_t *body,
+                                  double constant) {
   one_body_aux_t *result = malloc(sizeof(one_body_aux_t));
   assert(result);
-  result->body = body;
+  result->scene = scene;
+  result->body = scene_reserve_body_handle(scene, body);
   result->constant = constant;
   return result;
 }
 
-collision_aux_t *collision_aux_init(body_t *body1, body_t *body2,
-                                    collision_handler_t handler,
-                                    free_func_t aux_freer, void *aux) {
-  collision_aux_t *result = malloc(sizeof(collision_aux_t));
-  assert(result);
-  result->body1 = body1;
-  result->body2 = body2;
-  result->handler = handler;
-  result->aux = aux;
-  result->aux_freer = aux_freer;
-  result->is_colliding = false;
-  result->hold_colliding = false;
-  return result;
-}
-
 vector_t get_distance(vector_t centroid1, vector_t centroid2) {
   vector_t answer = {.x = centroid1.x - centroid2.x,
                      .y = centroid1.y - centroid2.y};
@@ -134,8 +107,10 @@ vector_t get_distance(vector_t centroid1, vector_t centroid2) {
 
 void apply_newtonian_gravity(void *two_body_aux) {
   two_body_aux_t *aux = (two_body_aux_t *)two_body_aux;
-  body_t *body1 = aux->body1;
-  body_t *body2 = aux->body2;
+  body_t *body1 = scene_resolve_body(aux->scene, aux->body1);
+  body_t *body2 = scene_resolve_body(aux->scene, aux->body2);
+  if (body1 == NULL || body2 == NULL)
+    return;
   double G = aux->constant;
   vector_t centroid1 = body_get_centroid(body1);
   vector_t centroid2 = body_get_centroid(body2);
@@ -157,7 +132,7 @@ void apply_newtonian_gravity(void *two_body_aux) {
 
 void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
                               body_t *body2) {
-  two_body_aux_t *aux = two_body_aux_init(body1, body2, G);
+  two_body_aux_t *aux = two_body_aux_init(scene, body1, body2, G);
   list_t *bodies = list_init(2, NULL);
   list_add(bodies, body1);
   list_add(bodies, body2);
@@ -174,8 +149,10 @@ vector_t get_spring_force(body_t *body, body_t *anchor, double k) {
 
 void apply_spring(void *two_body_aux) {
   two_body_aux_t *aux = (two_body_aux_t *)two_body_aux;
-  body_t *body = aux->body1;
-  body_t *anchor = aux->body2;
+  body_t *body = scene_resolve_body(aux->scene, aux->body1);
+  body_t *anchor = scene_resolve_body(aux->scene, aux->body2);
+  if (body == NULL || anchor == NULL)
+    return;
   double k = aux->constant;
   vector_t force = get_spring_force(body, anchor, k);
   vector_t body_force = body_get_force(body);
@@ -185,7 +162,7 @@ void apply_spring(void *two_body_aux) {
 }
 
 void create_spring(scene_t *scene, double k, body_t *body, body_t *anchor) {
-  two_body_aux_t *aux = two_body_aux_init(body, anchor, k);
+  two_body_aux_t *aux = two_body_aux_init(scene, body, anchor, k);
   list_t *bodies = list_init(2, NULL);
   list_add(bodies, body);
   list_add(bodies, anchor);
@@ -195,7 +172,9 @@ void create_spring(scene_t *scene, double k, body_t *body, body_t *anchor) {
 
 void apply_drag(void *one_body_aux) {
   one_body_aux_t *aux = (one_body_aux_t *)one_body_aux;
-  body_t *body = aux->body;
+  body_t *body = scene_resolve_body(aux->scene, aux->body);
+  if (body == NULL)
+    return;
   double gamma = aux->constant;
   vector_t vel = body_get_velocity(body);
   vector_t force = {.x = -gamma * vel.x, .y = -gamma * vel.y};
@@ -204,87 +183,34 @@ void apply_drag(void *one_body_aux) {
 }
 
 void create_drag(scene_t *scene, double gamma, body_t *body) {
-  one_body_aux_t *aux = one_body_aux_init(body, gamma);
+  one_body_aux_t *aux = one_body_aux_init(scene, body, gamma);
   list_t *bodies = list_init(1, NULL);
   list_add(bodies, body);
   scene_add_bodies_force_creator(scene, apply_drag, aux, bodies,
                                  one_body_aux_freer);
 }
 
-vector_t calculate_impulse(body_t *body1, body_t *body2, double elasticity,
-                           vector_t collision_axis) {
-  double m1 = body_get_mass(body1);
-  double m2 = body_get_mass(body2);
-  double u1 = vec_dot(body_get_velocity(body1), collision_axis);
-  double u2 = vec_dot(body_get_velocity(body2), collision_axis);
-  double impulse;
-  if (m1 == INFINITY)
-    impulse = m2 * (1 + elasticity) * (u2 - u1);
-  if (m2 == INFINITY)
-    impulse = m1 * (1 + elasticity) * (u2 - u1);
-  else
-    impulse = m1 * m2 / (m1 + m2) * (1 + elasticity) * (u2 - u1);
-  vector_t vec = vec_normalize(collision_axis);
-  return vec_multiply(impulse, vec);
-}
-
-
 vector_t get_impulse(double impulse) {
   vector_t result = {.x = 0, .y = impulse};
   return result;
 }
 
-void apply_destructive_collision(void *two_body_aux) {
-  two_body_aux_t *aux = (two_body_aux_t *)two_body_aux;
-  list_t *shape1 = body_get_shape(aux->body1);
-  list_t *shape2 = body_get_shape(aux->body2);
-  if (collision_get_collided(find_collision(shape1, shape2))) {
-    body_remove(aux->body1);
-    body_remove(aux->body2);
-  }
-  list_free(shape1);
-  list_free(shape2);
-}
-
-void create_destructive_collision(scene_t *scene, body_t *body1,
-                                  body_t *body2) {
-  two_body_aux_t *aux = two_body_aux_init(body1, body2, 0);
-  list_t *bodies = list_init(2, NULL);
-  list_add(bodies, body1);
-  list_add(bodies, body2);
-  scene_add_bodies_force_creator(scene, apply_destructive_collision, aux,
-                                 bodies, two_body_aux_freer);
+void create_collision(scene_t *scene, body_t *body1, body_t *body2,
+                      collision_handler_t handler, void *aux,
+                      free_func_t freer) {
+  scene_add_collision_handler(scene, body1, body2, handler, aux, freer, false);
 }
 
-void apply_collision(void *c_aux) {
-  collision_aux_t *collision_aux = (collision_aux_t *)c_aux;
-  assert(collision_aux);
-  list_t *shape1 = body_get_shape(collision_aux->body1);
-  list_t *shape2 = body_get_shape(collision_aux->body2);
-  assert(shape1);
-  assert(shape2);
-  if (collision_get_collided(find_collision(shape1, shape2)) && (!collision_aux->is_colliding || collision_aux->hold_colliding)) {
-    vector_t collision_axis = collision_get_axis(find_collision(shape1, shape2));
-    collision_aux->handler(collision_aux->body1, collision_aux->body2,
-                           collision_axis, collision_aux->aux);
-    collision_aux->is_colliding = true;
-  }
-  if (!collision_get_collided(find_collision(shape1, shape2)))
-    collision_aux->is_colliding = false;
-  list_free(shape1);
-  list_free(shape2);
+void destructive_collision_handler(body_t *body1, body_t *body2,
+                                   vector_t axis, void *aux) {
+  body_remove(body1);
+  body_remove(body2);
 }
 
-void create_collision(scene_t *scene, body_t *body1, body_t *body2,
-                      collision_handler_t handler, void *aux,
-                      free_func_t freer) {
-  collision_aux_t *collision_aux =
-      collision_aux_init(body1, body2, handler, freer, aux);
-  list_t *bodies = list_init(2, NULL);
-  list_add(bodies, body1);
-  list_add(bodies, body2);
-  scene_add_bodies_force_creator(scene, apply_collision, collision_aux, bodies,
-                                 collision_aux_freer);
+void create_destructive_collision(scene_t *scene, body_t *body1,
+                                  body_t *body2) {
+  create_collision(scene, body1, body2, destructive_collision_handler, NULL,
+                   NULL);
 }
 
 void jump_collision_handler(body_t *ball, body_t *target, vector_t axis,
@@ -297,22 +223,9 @@ void jump_collision_handler(body_t *ball, body_t *target, vector_t axis,
   body_add_impulse(target, opposite_impulse_vector);
 }
 
-void physics_collision_handler(body_t *ball, body_t *target, vector_t axis,
-                               void *aux) {
-  assert(ball);
-  assert(target);
-  vector_t impulse_vector =
-      calculate_impulse(ball, target, .5, axis);
-  body_add_impulse(ball, impulse_vector);
-  vector_t opposite_impulse_vector = vec_multiply(-1, impulse_vector);
-  body_add_impulse(target, opposite_impulse_vector);
-}
-
 void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
                               body_t *body2) {
-  two_body_aux_t *aux = two_body_aux_init(body1, body2, elasticity);
-  create_collision(scene, body1, body2, physics_collision_handler, aux,
-                   two_body_aux_freer);
+  scene_set_collision_solid(scene, body1, body2, elasticity);
 }
 
 void one_sided_destructive_collision_handler(body_t *body1,
@@ -323,27 +236,29 @@ void one_sided_destructive_collision_handler(body_t *body1,
 
 void create_one_sided_destructive_collision(scene_t *scene, body_t *body1,
                                             body_t *body_to_destruct) {
-  two_body_aux_t *aux = two_body_aux_init(body1, body_to_destruct, 0);
+  two_body_aux_t *aux = two_body_aux_init(scene, body1, body_to_destruct, 0);
   create_collision(scene, body1, body_to_destruct,
                    one_sided_destructive_collision_handler, aux,
                    two_body_aux_freer);
 }
 
 void jump_up(scene_t *scene, body_t *body1, body_t *body2, double elasticity) {
-  two_body_aux_t *aux = two_body_aux_init(body1, body2, elasticity);
-  collision_aux_t *collision_aux = collision_aux_init(body1, body2, 
-                          jump_collision_handler, two_body_aux_freer, aux);
-  apply_collision(collision_aux);
+  collision_info_t collision = scene_find_collision(scene, body1, body2);
+  if (collision_get_collided(collision))
+    jump_collision_handler(body1, body2, collision_get_axis(collision), NULL);
 }
 
 void apply_universal_gravity(void *aux) {
   one_body_aux_t *oba = (one_body_aux_t*)aux;
+  body_t *body = scene_resolve_body(oba->scene, oba->body);
+  if (body == NULL)
+    return;
   vector_t gravity = {.x = 0, .y = oba->constant};
-  body_add_force(oba->body, gravity);
+  body_add_force(body, gravity);
 }
 
 void create_universal_gravity(scene_t *scene, body_t *body, double gravity) {
-  one_body_aux_t *aux = one_body_aux_init(body, gravity);
+  one_body_aux_t *aux = one_body_aux_init(scene, body, gravity);
   list_t *bodies = list_init(1, NULL);
   list_add(bodies, body);
   scene_add_bodies_force_creator(scene, apply_universal_gravity, aux,
@@ -369,21 +284,15 @@ void normal_force_collision_handler(body_t *body, body_t *ledge, vector_t axis,
 void create_collision_hold_on(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       free_func_t freer) {
-  collision_aux_t *collision_aux =
-      collision_aux_init(body1, body2, handler, freer, aux);
-  collision_aux->hold_colliding = true;
-  list_t *bodies = list_init(2, NULL);
-  list_add(bodies, body1);
-  list_add(bodies, body2);
-  scene_add_bodies_force_creator(scene, apply_collision, collision_aux, bodies,
-                                 collision_aux_freer);
+  scene_add_collision_handler(scene, body1, body2, handler, aux, freer, true);
 }
 
 void create_normal_force(scene_t *scene, body_t *body, body_t *ledge, double gravity) {
-  two_body_aux_t *aux = two_body_aux_init(body, ledge, gravity);
+  two_body_aux_t *aux = two_body_aux_init(scene, body, ledge, gravity);
   create_collision_hold_on(scene, body, ledge,
                    normal_force_collision_handler, aux,
                    two_body_aux_freer);
+  scene_set_collision_solid(scene, body, ledge, 0);
 }
 
 void game_over_collision_handler(body_t *ball, body_t *target, vector_t axis, void *aux) {
@@ -524,10 +433,12 @@ void create_ice_force(scene_t *scene, body_t *sprite, body_t *ice, double elasti
   create_collision_hold_on(scene, sprite, ice, ice_collision_handler, scene, two_body_aux_freer);
 }
 
-bodies_collision_aux_t *bodies_collision_aux_init(list_t *bodies,
+bodies_collision_aux_t *bodies_collision_aux_init(scene_t *scene,
+                                    list_t *bodies,
                                     bodies_collision_handler_t handler,
                                     free_func_t aux_freer, void *aux) {
-  bodies_collision_aux_t *result = malloc(sizeof(collision_aux_t));
+  bodies_collision_aux_t *result = malloc(sizeof(bodies_collision_aux_t));
+  result->scene = scene;
   result->bodies = bodies;
   assert(result->bodies);
   result->handler = handler;
@@ -546,14 +457,11 @@ void apply_collision_multiple(void *c_aux) {
   for (size_t i = 0; i < list_size(collision_aux->bodies) - 1; i+=2) {
     body_t *body1 = list_get(collision_aux->bodies, i);
     body_t *body2 = list_get(collision_aux->bodies, i + 1);
-    list_t *shape1 = body_get_shape(body1);
-    list_t *shape2 = body_get_shape(body2);
-    assert(shape1);
-    assert(shape2);
-    if (!collision_get_collided(find_collision(shape1, shape2)))
+    if (!collision_get_collided(
+            scene_find_collision(collision_aux->scene, body1, body2))) {
       keep_track = false;
-    list_free(shape1);
-    list_free(shape2);
+      break;
+    }
   }
   collision_aux->is_colliding = keep_track;
   if (collision_aux->is_colliding)
@@ -565,6 +473,7 @@ void bodies_collision_aux_freer(void *collision_aux) {
   assert(ca);
   if (ca->aux_freer != NULL)
     ca->aux_freer(ca->aux);
+  list_free(ca->bodies);
   free(ca);
 }
 
@@ -572,15 +481,18 @@ void create_collision_multiple(scene_t *scene, list_t *bodies,
                       bodies_collision_handler_t handler, void *aux,
                       free_func_t aux_freer) {
   list_t *bodies_null_freer = list_init(10, NULL);
+  list_t *force_bodies = list_init(10, NULL);
   for (size_t i = 0; i < list_size(bodies); i++) {
     body_t *body = list_get(bodies, i);
     list_add(bodies_null_freer, body);
+    list_add(force_bodies, body);
   }
   
   bodies_collision_aux_t *collision_aux =
-      bodies_collision_aux_init(bodies_null_freer, handler, aux_freer, aux);
+      bodies_collision_aux_init(scene, bodies_null_freer, handler,
+                                aux_freer, aux);
   assert(list_size(bodies_null_freer) > 0);
-  scene_add_bodies_force_creator(scene, apply_collision_multiple, collision_aux, bodies_null_freer,
+  scene_add_bodies_force_creator(scene, apply_collision_multiple, collision_aux, force_bodies,
                                  bodies_collision_aux_freer);
 }
 
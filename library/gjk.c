@@ -0,0 +1,190 @@
+#include "gjk.h"
+#include "polygon.h"
+#include "vector.h"
+#include <math.h>
+#include <stdbool.h>
+
+// The most vertices the expanding polytope can grow to. The Minkowski
+// difference of two polygons has as many vertices as both together, which
+// may be more, so a polytope that fills up is given up on as degenerate.
+#define EPA_MAX_VERTICES 128
+
+const size_t GJK_MAX_ITERATIONS = 64;
+// How close a polytope edge must be to the Minkowski difference's boundary
+// for its normal to be taken as the axis of least penetration
+const double EPA_TOLERANCE = 1e-7;
+// Squared lengths and areas below this are treated as zero
+const double GJK_EPSILON = 1e-18;
+
+vector_t gjk_support(shape_view_t shape, vector_t direction) {
+  if (shape.radius > 0) {
+    double length =
+        sqrt(direction.x * direction.x + direction.y * direction.y);
+    vector_t result = {
+        .x = shape.center.x + shape.radius * direction.x / length,
+        .y = shape.center.y + shape.radius * direction.y / length};
+    return result;
+  }
+  if (shape.normals != NULL && shape.half_extents.x > 0) {
+    // The corner on the direction's side of both axes of a rectangle
+    double hx = shape.half_extents.x;
+    double hy = shape.half_extents.y;
+    if (vec_dot(shape.normals[0], direction) < 0)
+      hx = -hx;
+    if (vec_dot(shape.normals[1], direction) < 0)
+      hy = -hy;
+    vector_t result = {
+        .x = shape.center.x + hx * shape.normals[0].x + hy * shape.normals[1].x,
+        .y = shape.center.y + hx * shape.normals[0].y + hy * shape.normals[1].y};
+    return result;
+  }
+  return shape.points[polygon_find_extreme(shape, direction)];
+}
+
+/**
+ * Gets the point of the Minkowski difference shape1 - shape2 farthest along
+ * a direction. The difference contains the origin iff the shapes overlap.
+ */
+vector_t gjk_minkowski_support(shape_view_t shape1, shape_view_t shape2,
+                               vector_t direction) {
+  return vec_subtract(gjk_support(shape1, direction),
+                      gjk_support(shape2, vec_negate(direction)));
+}
+
+/**
+ * Gets a vector perpendicular to an edge, on the side of a target direction.
+ */
+vector_t gjk_perpendicular_towards(vector_t edge, vector_t target) {
+  vector_t result = {.x = -edge.y, .y = edge.x};
+  if (vec_dot(result, target) < 0)
+    result = vec_negate(result);
+  return result;
+}
+
+/**
+ * Reduces a simplex to the feature closest to the origin, with the newest
+ * point last, and sets the direction to search next.
+ * Returns true if the simplex is a triangle containing the origin.
+ */
+bool gjk_update_simplex(vector_t *simplex, size_t *n_points,
+                        vector_t *direction) {
+  vector_t a = simplex[*n_points - 1];
+  vector_t to_origin = vec_negate(a);
+  if (*n_points == 2) {
+    vector_t ab = vec_subtract(simplex[0], a);
+    if (vec_dot(ab, to_origin) > 0) {
+      *direction = gjk_perpendicular_towards(ab, to_origin);
+    } else {
+      simplex[0] = a;
+      *n_points = 1;
+      *direction = to_origin;
+    }
+    return false;
+  }
+
+  vector_t b = simplex[1];
+  vector_t c = simplex[0];
+  vector_t ab = vec_subtract(b, a);
+  vector_t ac = vec_subtract(c, a);
+  vector_t ab_outside = gjk_perpendicular_towards(ab, vec_negate(ac));
+  if (vec_dot(ab_outside, to_origin) > 0) {
+    simplex[0] = b;
+    simplex[1] = a;
+    *n_points = 2;
+    *direction = ab_outside;
+    return false;
+  }
+  vector_t ac_outside = gjk_perpendicular_towards(ac, vec_negate(ab));
+  if (vec_dot(ac_outside, to_origin) > 0) {
+    simplex[1] = a;
+    *n_points = 2;
+    *direction = ac_outside;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Expands a triangle inside the Minkowski difference that contains the
+ * origin until its edge closest to the origin lies on the difference's
+ * boundary, and stores that edge's normal in axis.
+ */
+gjk_result_t epa_find_axis(shape_view_t shape1, shape_view_t shape2,
+                           const vector_t *triangle, vector_t *axis) {
+  vector_t polytope[EPA_MAX_VERTICES];
+  polytope[0] = triangle[0];
+  polytope[1] = triangle[1];
+  polytope[2] = triangle[2];
+  double area = vec_cross(vec_subtract(polytope[1], polytope[0]),
+                          vec_subtract(polytope[2], polytope[0]));
+  if (fabs(area) < GJK_EPSILON)
+    return GJK_DEGENERATE;
+  // Keep the polytope counterclockwise, so edge normals face outwards
+  if (area < 0) {
+    polytope[1] = triangle[2];
+    polytope[2] = triangle[1];
+  }
+  size_t n_points = 3;
+
+  while (true) {
+    size_t closest = 0;
+    double min_distance = INFINITY;
+    vector_t normal = VEC_ZERO;
+    for (size_t i = 0; i < n_points; i++) {
+      vector_t edge =
+          vec_subtract(polytope[(i + 1) % n_points], polytope[i]);
+      double length_squared = vec_dot(edge, edge);
+      if (length_squared < GJK_EPSILON)
+        continue;
+      double length = sqrt(length_squared);
+      vector_t edge_normal = {.x = edge.y / length, .y = -edge.x / length};
+      double distance = vec_dot(edge_normal, polytope[i]);
+      if (distance < min_distance) {
+        min_distance = distance;
+        closest = i;
+        normal = edge_normal;
+      }
+    }
+    if (min_distance == INFINITY)
+      return GJK_DEGENERATE;
+
+    vector_t point = gjk_minkowski_support(shape1, shape2, normal);
+    if (vec_dot(point, normal) - min_distance < EPA_TOLERANCE) {
+      *axis = normal;
+      return GJK_OVERLAPPING;
+    }
+    // The closest edge is not on the boundary yet, so it is not the axis
+    if (n_points == EPA_MAX_VERTICES)
+      return GJK_DEGENERATE;
+    // Split the closest edge at the new point
+    for (size_t i = n_points; i > closest + 1; i--)
+      polytope[i] = polytope[i - 1];
+    polytope[closest + 1] = point;
+    n_points++;
+  }
+}
+
+gjk_result_t gjk_find_axis(shape_view_t shape1, shape_view_t shape2,
+                           vector_t *axis) {
+  vector_t simplex[3];
+  size_t n_points = 0;
+  vector_t direction = vec_subtract(shape2.points[0], shape1.points[0]);
+  if (vec_dot(direction, direction) < GJK_EPSILON)
+    direction = (vector_t){.x = 1, .y = 0};
+  simplex[n_points++] = gjk_minkowski_support(shape1, shape2, direction);
+  direction = vec_negate(simplex[0]);
+
+  for (size_t i = 0; i < GJK_MAX_ITERATIONS; i++) {
+    // The origin lies on the simplex, so the shapes at least touch
+    if (vec_dot(direction, direction) < GJK_EPSILON)
+      return GJK_DEGENERATE;
+    vector_t point = gjk_minkowski_support(shape1, shape2, direction);
+    // Nothing of the difference lies past the origin in this direction
+    if (vec_dot(point, direction) <= 0)
+      return GJK_SEPARATED;
+    simplex[n_points++] = point;
+    if (gjk_update_simplex(simplex, &n_points, &direction))
+      return epa_find_axis(shape1, shape2, simplex, axis);
+  }
+  return GJK_DEGENERATE;
+}
@@ -25,24 +25,17 @@ list_t *list_init(size_t capacity, free_func_t freer) {
   return result;
 }
 
+void list_reserve(list_t *list, size_t capacity) {
+  if (capacity <= list->capacity)
+    return;
+  list->data = realloc(list->data, sizeof(void *) * capacity);
+  assert(list->data);
+  list->capacity = capacity;
+}
+
 void ensure_capacity(list_t *list) {
-  if (list->capacity == 0) {
-    list->capacity = 1;
-    void **new_data = malloc(sizeof(void *) * list->capacity);
-    free(list->data);
-    list->data = new_data;
-    assert(list->data);
-  } else if (list->size >= list->capacity) {
-    void **new_data = malloc(sizeof(void *) * list->capacity * 2);
-    assert(new_data);
-    for (size_t i = 0; i < list->capacity; i++) {
-      new_data[i] = list->data[i];
-    }
-    list->capacity *= 2;
-    free(list->data);
-    list->data = new_data;
-    assert(list->data);
-  }
+  if (list->size >= list->capacity)
+    list_reserve(list, list->capacity == 0 ? 1 : list->capacity * 2);
   assert(list->capacity > 0);
 }
 
@@ -59,6 +52,20 @@ void *list_get(list_t *list, size_t index) {
   return list->data[index];
 }
 
+void list_append_array(list_t *list, void *const *items, size_t n_items) {
+  size_t needed = list->size + n_items;
+  if (needed > list->capacity) {
+    size_t capacity = list->capacity == 0 ? 1 : list->capacity;
+    while (capacity < needed)
+      capacity *= 2;
+    list_reserve(list, capacity);
+  }
+  for (size_t i = 0; i < n_items; i++) {
+    assert(items[i]);
+    list->data[list->size++] = items[i];
+  }
+}
+
 size_t list_size(list_t *list) {
   assert(list);
   return list->size;
@@ -74,14 +81,42 @@ void *list_remove(list_t *list, size_t index) {
   return answer;
 }
 
-void list_free(void *to_free) {
-  list_t *list = (list_t *)to_free;
+void *list_swap_remove(list_t *list, size_t index) {
+  assert(index < list->size);
+  void *answer = list->data[index];
+  list->data[index] = list->data[--list->size];
+  return answer;
+}
+
+size_t list_remove_if(list_t *list, list_predicate_t predicate, void *aux) {
+  size_t kept = 0;
+  for (size_t i = 0; i < list->size; i++) {
+    void *item = list->data[i];
+    if (predicate(item, aux)) {
+      if (list->freer != NULL)
+        list->freer(item);
+    } else {
+      list->data[kept++] = item;
+    }
+  }
+  size_t removed = list->size - kept;
+  list->size = kept;
+  return removed;
+}
+
+void list_clear(list_t *list) {
   if (list->freer != NULL) {
     for (size_t i = 0; i < list->size; i++) {
       if (list->data[i] != NULL)
         list->freer(list->data[i]);
     }
   }
+  list->size = 0;
+}
+
+void list_free(void *to_free) {
+  list_t *list = (list_t *)to_free;
+  list_clear(list);
   free(list->data);
   assert(list);
   free(list);
@@ -0,0 +1,1139 @@
+#include "pair_manager.h"
+#include "body.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "list.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const size_t PAIR_MANAGER_INITIAL_CAPACITY = 16;
+// Marks a pair that is not in the manager's active pairs
+const size_t PAIR_NOT_ACTIVE = SIZE_MAX;
+// The fraction of the penetration depth corrected each tick
+const double POSITION_CORRECTION_FRACTION = 0.4;
+// The penetration depth left uncorrected
+const double POSITION_CORRECTION_SLOP = 0.1;
+// Approach speeds below this do not bounce, so resting bodies settle
+const double RESTITUTION_VELOCITY_THRESHOLD = 10;
+// The least cosine between a pair's axes on consecutive ticks for its last
+// impulse to warm start the solver
+const double WARM_START_MIN_ALIGNMENT = 0.9;
+// How far past its time of impact a swept bullet is moved, so its
+// collision is seen on the next tick
+const double SWEEP_CONTACT_DEPTH = 0.25;
+// Bullets that moved less than this fraction of their smallest extent
+// cannot have passed through anything much smaller than themselves,
+// so they are not swept
+const double SWEEP_MOTION_THRESHOLD = 0.5;
+
+typedef struct pair_handler_entry {
+  pair_handler_t handler;
+  void *aux;
+  free_func_t freer;
+  // Whether the handler was registered with the pair's bodies reversed
+  bool swapped;
+  bool persistent;
+  // Set until the handler's first update, so a handler added while the
+  // bodies are already colliding still sees that collision once
+  bool is_new;
+} pair_handler_entry_t;
+
+typedef struct collision_pair {
+  pair_manager_t *manager;
+  body_handle_t body1;
+  body_handle_t body2;
+  // The pair's index in the manager's pairs in the order they were added
+  size_t order;
+  // The pair's index in the manager's active pairs, or PAIR_NOT_ACTIVE
+  size_t active_index;
+  // The update pass that last queued the pair
+  uint32_t pass;
+  // Set while the pair is queued because the broadphase found its bodies'
+  // boxes overlapping, so the update need not test them again
+  bool is_candidate;
+  pair_state_t state;
+  bool solid;
+  double elasticity;
+  // The impulse the solver applied along impulse_axis on the last tick,
+  // used to warm start the next one
+  double normal_impulse;
+  vector_t impulse_axis;
+  pair_handler_entry_t *handlers;
+  size_t n_handlers;
+  size_t handlers_capacity;
+} collision_pair_t;
+
+// A memoized narrowphase result, oriented from body1 to body2
+typedef struct narrowphase_entry {
+  body_handle_t body1;
+  body_handle_t body2;
+  // The bodies' geometry versions when they were tested
+  uint32_t version1;
+  uint32_t version2;
+  // The entry is only occupied if this matches the manager's stamp
+  uint32_t stamp;
+  collision_info_t collision;
+} narrowphase_entry_t;
+
+// A collision of a solid pair awaiting the solver and positional correction
+typedef struct pair_contact {
+  collision_pair_t *pair;
+  body_handle_t body1;
+  body_handle_t body2;
+  collision_info_t collision;
+  // Both are 0 if the contact is skipped
+  double inverse_mass1;
+  double inverse_mass2;
+  // The separating speed the solver aims for
+  double bias;
+  // The impulse accumulated along the axis so far, never negative
+  double impulse;
+} pair_contact_t;
+
+// A bullet's motion over the tick being integrated
+typedef struct bullet_sweep {
+  body_handle_t body;
+  vector_t start;
+  // Set by pair_manager_sweep_bullets() if the bullet moved far enough
+  // to be swept, with how far it moved and the box covering its motion
+  bool moving;
+  vector_t displacement;
+  aabb_t swept;
+  // The earliest fraction of the motion at which it hit a body it has a
+  // pair with, or INFINITY, that body, and its displacement relative to it
+  double impact;
+  body_handle_t impact_body;
+  vector_t impact_displacement;
+  // How far it is moved back from where it ended the tick, before following
+  // the body it hit if that body is moved back too
+  vector_t correction;
+} bullet_sweep_t;
+
+// Where a body started the tick being integrated
+typedef struct body_start {
+  body_handle_t body;
+  vector_t start;
+} body_start_t;
+
+typedef struct pair_manager {
+  body_pool_t *pool;
+  broadphase_t *broadphase;
+  list_t *bodies;
+  // Open-addressed hash table of pairs, with a power of two capacity
+  collision_pair_t **table;
+  size_t capacity;
+  size_t n_pairs;
+  // Every pair in the order it was added, with NULL where pairs were freed
+  collision_pair_t **ordered;
+  size_t n_ordered;
+  size_t n_freed;
+  size_t ordered_capacity;
+  // The pairs of each body, by body slot
+  list_t **body_pairs;
+  size_t body_pairs_capacity;
+  // The pairs the last update pass left colliding or just separated, which
+  // are updated again even if the broadphase no longer reports them
+  collision_pair_t **active;
+  size_t n_active;
+  size_t active_capacity;
+  // The pairs queued for the current update pass
+  collision_pair_t **updates;
+  size_t n_updates;
+  size_t updates_capacity;
+  uint32_t pass;
+  // Open-addressed hash table of this tick's narrowphase results,
+  // with a power of two capacity
+  narrowphase_entry_t *cache;
+  size_t cache_capacity;
+  size_t n_cached;
+  uint32_t stamp;
+  pair_contact_t *contacts;
+  size_t n_contacts;
+  size_t contacts_capacity;
+  // The solver's working velocities, indexed by body slot
+  vector_t *velocities;
+  size_t velocities_capacity;
+  // The bullets saved by pair_manager_save_bullets(), and the index of each
+  // in sweeps by body slot
+  bullet_sweep_t *sweeps;
+  size_t n_sweeps;
+  size_t sweeps_capacity;
+  size_t *sweep_indices;
+  size_t sweep_indices_capacity;
+  // Where every body started the tick, by body slot, so bullets can be
+  // swept relative to the bodies they hit
+  body_start_t *starts;
+  size_t starts_capacity;
+} pair_manager_t;
+
+void collision_pair_free(collision_pair_t *pair);
+
+pair_manager_t *pair_manager_init(body_pool_t *pool, broadphase_t *broadphase,
+                                  list_t *bodies) {
+  pair_manager_t *result = malloc(sizeof(pair_manager_t));
+  assert(result);
+  result->pool = pool;
+  result->broadphase = broadphase;
+  result->bodies = bodies;
+  result->capacity = PAIR_MANAGER_INITIAL_CAPACITY;
+  result->table = calloc(result->capacity, sizeof(collision_pair_t *));
+  assert(result->table);
+  result->n_pairs = 0;
+  result->ordered = NULL;
+  result->n_ordered = 0;
+  result->n_freed = 0;
+  result->ordered_capacity = 0;
+  result->body_pairs = NULL;
+  result->body_pairs_capacity = 0;
+  result->active = NULL;
+  result->n_active = 0;
+  result->active_capacity = 0;
+  result->updates = NULL;
+  result->n_updates = 0;
+  result->updates_capacity = 0;
+  result->pass = 0;
+  result->cache = NULL;
+  result->cache_capacity = 0;
+  result->n_cached = 0;
+  result->stamp = 1;
+  result->contacts = NULL;
+  result->n_contacts = 0;
+  result->contacts_capacity = 0;
+  result->velocities = NULL;
+  result->velocities_capacity = 0;
+  result->sweeps = NULL;
+  result->n_sweeps = 0;
+  result->sweeps_capacity = 0;
+  result->sweep_indices = NULL;
+  result->sweep_indices_capacity = 0;
+  result->starts = NULL;
+  result->starts_capacity = 0;
+  return result;
+}
+
+void pair_manager_free(pair_manager_t *manager) {
+  for (size_t i = 0; i < manager->n_ordered; i++) {
+    if (manager->ordered[i] != NULL)
+      collision_pair_free(manager->ordered[i]);
+  }
+  for (size_t i = 0; i < manager->body_pairs_capacity; i++) {
+    if (manager->body_pairs[i] != NULL)
+      list_free(manager->body_pairs[i]);
+  }
+  free(manager->body_pairs);
+  free(manager->ordered);
+  free(manager->active);
+  free(manager->updates);
+  free(manager->table);
+  free(manager->cache);
+  free(manager->contacts);
+  free(manager->velocities);
+  free(manager->sweeps);
+  free(manager->sweep_indices);
+  free(manager->starts);
+  free(manager);
+}
+
+size_t pair_manager_size(pair_manager_t *manager) { return manager->n_pairs; }
+
+/**
+ * Appends a pair to a growable array of pairs.
+ */
+void pair_array_add(collision_pair_t ***array, size_t *size, size_t *capacity,
+                    collision_pair_t *pair) {
+  if (*size == *capacity) {
+    *capacity = *capacity == 0 ? PAIR_MANAGER_INITIAL_CAPACITY : 2 * *capacity;
+    *array = realloc(*array, sizeof(collision_pair_t *) * *capacity);
+    assert(*array);
+  }
+  (*array)[(*size)++] = pair;
+}
+
+/**
+ * Gets the list of pairs of the body in a given handle slot,
+ * creating it if needed.
+ */
+list_t *pair_manager_body_pairs(pair_manager_t *manager, size_t slot) {
+  if (slot >= manager->body_pairs_capacity) {
+    size_t capacity = manager->body_pairs_capacity * 2;
+    if (capacity <= slot)
+      capacity = slot + 1;
+    manager->body_pairs =
+        realloc(manager->body_pairs, sizeof(list_t *) * capacity);
+    assert(manager->body_pairs);
+    for (size_t i = manager->body_pairs_capacity; i < capacity; i++)
+      manager->body_pairs[i] = NULL;
+    manager->body_pairs_capacity = capacity;
+  }
+  if (manager->body_pairs[slot] == NULL)
+    manager->body_pairs[slot] = list_init(2, NULL);
+  return manager->body_pairs[slot];
+}
+
+/**
+ * Removes a pair from the list of pairs of the body in a given handle slot.
+ */
+void pair_manager_unlink_pair(pair_manager_t *manager, size_t slot,
+                              collision_pair_t *pair) {
+  list_t *pairs = manager->body_pairs[slot];
+  for (size_t i = 0; i < list_size(pairs); i++) {
+    if (list_get(pairs, i) == pair) {
+      list_swap_remove(pairs, i);
+      return;
+    }
+  }
+}
+
+/**
+ * Hashes the slots of an unordered pair of handles.
+ */
+size_t pair_manager_hash(body_handle_t handle1, body_handle_t handle2) {
+  uint64_t low = handle1.index < handle2.index ? handle1.index : handle2.index;
+  uint64_t high = handle1.index < handle2.index ? handle2.index : handle1.index;
+  uint64_t key = ((low << 32) | high) * 0x9e3779b97f4a7c15ULL;
+  return (size_t)(key ^ (key >> 29));
+}
+
+bool handles_equal(body_handle_t handle1, body_handle_t handle2) {
+  return handle1.index == handle2.index &&
+         handle1.generation == handle2.generation;
+}
+
+bool collision_pair_matches(collision_pair_t *pair, body_handle_t handle1,
+                            body_handle_t handle2) {
+  return (handles_equal(pair->body1, handle1) &&
+          handles_equal(pair->body2, handle2)) ||
+         (handles_equal(pair->body1, handle2) &&
+          handles_equal(pair->body2, handle1));
+}
+
+/**
+ * Finds the table index holding the pair of two handles,
+ * or the empty index where it would be inserted.
+ */
+size_t pair_manager_find(pair_manager_t *manager, body_handle_t handle1,
+                         body_handle_t handle2) {
+  size_t mask = manager->capacity - 1;
+  size_t i = pair_manager_hash(handle1, handle2) & mask;
+  while (manager->table[i] != NULL &&
+         !collision_pair_matches(manager->table[i], handle1, handle2))
+    i = (i + 1) & mask;
+  return i;
+}
+
+/**
+ * Doubles the table when it would become more than half full.
+ */
+void pair_manager_reserve(pair_manager_t *manager, size_t n_pairs) {
+  if (2 * n_pairs <= manager->capacity)
+    return;
+  collision_pair_t **old_table = manager->table;
+  size_t old_capacity = manager->capacity;
+  manager->capacity *= 2;
+  manager->table = calloc(manager->capacity, sizeof(collision_pair_t *));
+  assert(manager->table);
+  for (size_t i = 0; i < old_capacity; i++) {
+    collision_pair_t *pair = old_table[i];
+    if (pair != NULL)
+      manager->table[pair_manager_find(manager, pair->body1, pair->body2)] =
+          pair;
+  }
+  free(old_table);
+}
+
+/**
+ * Finds the pair of two bodies, adding it if needed.
+ */
+collision_pair_t *pair_manager_get_pair(pair_manager_t *manager,
+                                        body_handle_t handle1,
+                                        body_handle_t handle2) {
+  pair_manager_reserve(manager, manager->n_pairs + 1);
+  size_t index = pair_manager_find(manager, handle1, handle2);
+  collision_pair_t *pair = manager->table[index];
+  if (pair != NULL)
+    return pair;
+  pair = malloc(sizeof(collision_pair_t));
+  assert(pair);
+  pair->manager = manager;
+  pair->body1 = handle1;
+  pair->body2 = handle2;
+  pair->order = manager->n_ordered;
+  pair->active_index = PAIR_NOT_ACTIVE;
+  pair->pass = 0;
+  pair->is_candidate = false;
+  pair->state = PAIR_SEPARATED;
+  pair->solid = false;
+  pair->elasticity = 0;
+  pair->normal_impulse = 0;
+  pair->impulse_axis = VEC_ZERO;
+  pair->handlers = NULL;
+  pair->n_handlers = 0;
+  pair->handlers_capacity = 0;
+  manager->table[index] = pair;
+  manager->n_pairs++;
+  pair_array_add(&manager->ordered, &manager->n_ordered,
+                 &manager->ordered_capacity, pair);
+  list_add(pair_manager_body_pairs(manager, handle1.index), pair);
+  list_add(pair_manager_body_pairs(manager, handle2.index), pair);
+  return pair;
+}
+
+void pair_manager_add_handler(pair_manager_t *manager, body_t *body1,
+                              body_t *body2, pair_handler_t handler, void *aux,
+                              free_func_t freer, bool persistent) {
+  body_handle_t handle1 = body_pool_reserve_handle(manager->pool, body1);
+  body_handle_t handle2 = body_pool_reserve_handle(manager->pool, body2);
+  collision_pair_t *pair = pair_manager_get_pair(manager, handle1, handle2);
+
+  if (pair->n_handlers == pair->handlers_capacity) {
+    pair->handlers_capacity =
+        pair->handlers_capacity == 0 ? 1 : 2 * pair->handlers_capacity;
+    pair->handlers = realloc(pair->handlers, sizeof(pair_handler_entry_t) *
+                                                 pair->handlers_capacity);
+    assert(pair->handlers);
+  }
+  pair_handler_entry_t *entry = &pair->handlers[pair->n_handlers++];
+  entry->handler = handler;
+  entry->aux = aux;
+  entry->freer = freer;
+  entry->swapped = !handles_equal(pair->body1, handle1);
+  entry->persistent = persistent;
+  entry->is_new = true;
+}
+
+void pair_manager_set_solid(pair_manager_t *manager, body_t *body1,
+                            body_t *body2, double elasticity) {
+  body_handle_t handle1 = body_pool_reserve_handle(manager->pool, body1);
+  body_handle_t handle2 = body_pool_reserve_handle(manager->pool, body2);
+  collision_pair_t *pair = pair_manager_get_pair(manager, handle1, handle2);
+  pair->solid = true;
+  pair->elasticity = elasticity;
+}
+
+/**
+ * Records the collision of a solid pair for the solver and positional
+ * correction.
+ */
+void pair_manager_add_contact(pair_manager_t *manager, collision_pair_t *pair,
+                              collision_info_t collision) {
+  if (manager->n_contacts == manager->contacts_capacity) {
+    manager->contacts_capacity = manager->contacts_capacity == 0
+                                     ? PAIR_MANAGER_INITIAL_CAPACITY
+                                     : 2 * manager->contacts_capacity;
+    manager->contacts =
+        realloc(manager->contacts,
+                sizeof(pair_contact_t) * manager->contacts_capacity);
+    assert(manager->contacts);
+  }
+  pair_contact_t *contact = &manager->contacts[manager->n_contacts++];
+  contact->pair = pair;
+  contact->body1 = pair->body1;
+  contact->body2 = pair->body2;
+  contact->collision = collision;
+}
+
+/**
+ * Gets the reciprocal of a body's mass, which is 0 for infinite masses.
+ */
+double inverse_mass(body_t *body) { return 1 / body_get_mass(body); }
+
+/**
+ * Grows the solver's working velocities to cover a body slot.
+ */
+void pair_manager_reserve_velocities(pair_manager_t *manager, size_t slot) {
+  if (slot < manager->velocities_capacity)
+    return;
+  size_t capacity = manager->velocities_capacity == 0
+                        ? PAIR_MANAGER_INITIAL_CAPACITY
+                        : manager->velocities_capacity;
+  while (capacity <= slot)
+    capacity *= 2;
+  manager->velocities =
+      realloc(manager->velocities, sizeof(vector_t) * capacity);
+  assert(manager->velocities);
+  manager->velocities_capacity = capacity;
+}
+
+/**
+ * Gets the velocity a body will have after integrating the forces and
+ * impulses applied to it so far this tick.
+ */
+vector_t predicted_velocity(body_t *body, double dt) {
+  vector_t velocity = body_get_velocity(body);
+  double mass = body_get_mass(body);
+  if (mass == INFINITY)
+    return velocity;
+  vector_t push = vec_add(body_get_impulse(body),
+                          vec_multiply(dt, body_get_force(body)));
+  return vec_add(velocity, vec_multiply(1 / mass, push));
+}
+
+/**
+ * Applies an impulse along a contact's axis to its bodies' working
+ * velocities, pushing body2 towards the axis and body1 away from it.
+ */
+void pair_contact_push(pair_manager_t *manager, pair_contact_t *contact,
+                       double impulse) {
+  vector_t axis = contact->collision.axis;
+  vector_t *velocity1 = &manager->velocities[contact->body1.index];
+  vector_t *velocity2 = &manager->velocities[contact->body2.index];
+  *velocity1 = vec_subtract(
+      *velocity1, vec_multiply(impulse * contact->inverse_mass1, axis));
+  *velocity2 =
+      vec_add(*velocity2, vec_multiply(impulse * contact->inverse_mass2, axis));
+}
+
+/**
+ * Gets the speed at which a contact's bodies are separating along its axis.
+ */
+double pair_contact_speed(pair_manager_t *manager, pair_contact_t *contact) {
+  vector_t relative = vec_subtract(manager->velocities[contact->body2.index],
+                                   manager->velocities[contact->body1.index]);
+  return vec_dot(relative, contact->collision.axis);
+}
+
+void pair_manager_solve_contacts(pair_manager_t *manager, double dt,
+                                 size_t iterations) {
+  // Every body starts from the velocity it would otherwise end the tick with
+  for (size_t i = 0; i < manager->n_contacts; i++) {
+    pair_contact_t *contact = &manager->contacts[i];
+    body_t *body1 = body_pool_resolve(manager->pool, contact->body1);
+    body_t *body2 = body_pool_resolve(manager->pool, contact->body2);
+    contact->inverse_mass1 = 0;
+    contact->inverse_mass2 = 0;
+    contact->impulse = 0;
+    if (body1 == NULL || body2 == NULL)
+      continue;
+    contact->inverse_mass1 = inverse_mass(body1);
+    contact->inverse_mass2 = inverse_mass(body2);
+    pair_manager_reserve_velocities(manager, contact->body1.index);
+    pair_manager_reserve_velocities(manager, contact->body2.index);
+    manager->velocities[contact->body1.index] = predicted_velocity(body1, dt);
+    manager->velocities[contact->body2.index] = predicted_velocity(body2, dt);
+  }
+
+  for (size_t i = 0; i < manager->n_contacts; i++) {
+    pair_contact_t *contact = &manager->contacts[i];
+    double speed = pair_contact_speed(manager, contact);
+    contact->bias = speed < -RESTITUTION_VELOCITY_THRESHOLD
+                        ? -contact->pair->elasticity * speed
+                        : 0;
+  }
+
+  // Reapply the impulses of contacts that persisted since the last tick,
+  // so a resting stack starts close to its solution
+  for (size_t i = 0; i < manager->n_contacts; i++) {
+    pair_contact_t *contact = &manager->contacts[i];
+    collision_pair_t *pair = contact->pair;
+    if (contact->inverse_mass1 + contact->inverse_mass2 == 0 ||
+        pair->state != PAIR_PERSIST)
+      continue;
+    double alignment = vec_dot(pair->impulse_axis, contact->collision.axis);
+    if (alignment < WARM_START_MIN_ALIGNMENT)
+      continue;
+    contact->impulse = pair->normal_impulse * alignment;
+    pair_contact_push(manager, contact, contact->impulse);
+  }
+
+  for (size_t k = 0; k < iterations; k++) {
+    for (size_t i = 0; i < manager->n_contacts; i++) {
+      pair_contact_t *contact = &manager->contacts[i];
+      double inverse_masses = contact->inverse_mass1 + contact->inverse_mass2;
+      if (inverse_masses == 0)
+        continue;
+      double impulse =
+          (contact->bias - pair_contact_speed(manager, contact)) /
+          inverse_masses;
+      // Contacts only push, so clamp the total rather than each step
+      double total = fmax(contact->impulse + impulse, 0);
+      pair_contact_push(manager, contact, total - contact->impulse);
+      contact->impulse = total;
+    }
+  }
+
+  for (size_t i = 0; i < manager->n_contacts; i++) {
+    pair_contact_t *contact = &manager->contacts[i];
+    if (contact->inverse_mass1 + contact->inverse_mass2 == 0)
+      continue;
+    vector_t axis = contact->collision.axis;
+    vector_t impulse = vec_multiply(contact->impulse, axis);
+    body_add_impulse(body_pool_resolve(manager->pool, contact->body1),
+                     vec_negate(impulse));
+    body_add_impulse(body_pool_resolve(manager->pool, contact->body2),
+                     impulse);
+    contact->pair->normal_impulse = contact->impulse;
+    contact->pair->impulse_axis = axis;
+  }
+}
+
+void pair_manager_correct_positions(pair_manager_t *manager) {
+  for (size_t i = 0; i < manager->n_contacts; i++) {
+    pair_contact_t *contact = &manager->contacts[i];
+    body_t *body1 = body_pool_resolve(manager->pool, contact->body1);
+    body_t *body2 = body_pool_resolve(manager->pool, contact->body2);
+    if (body1 == NULL || body2 == NULL)
+      continue;
+    double inverse_mass1 = inverse_mass(body1);
+    double inverse_mass2 = inverse_mass(body2);
+    double depth = contact->collision.depth - POSITION_CORRECTION_SLOP;
+    if (depth <= 0 || inverse_mass1 + inverse_mass2 == 0)
+      continue;
+    double correction = POSITION_CORRECTION_FRACTION * depth /
+                        (inverse_mass1 + inverse_mass2);
+    vector_t axis = contact->collision.axis;
+    vector_t centroid1 = body_get_centroid(body1);
+    vector_t centroid2 = body_get_centroid(body2);
+    if (inverse_mass1 > 0) {
+      centroid1.x -= axis.x * correction * inverse_mass1;
+      centroid1.y -= axis.y * correction * inverse_mass1;
+      body_set_centroid(body1, centroid1);
+    }
+    if (inverse_mass2 > 0) {
+      centroid2.x += axis.x * correction * inverse_mass2;
+      centroid2.y += axis.y * correction * inverse_mass2;
+      body_set_centroid(body2, centroid2);
+    }
+  }
+  manager->n_contacts = 0;
+}
+
+void pair_manager_save_bullets(pair_manager_t *manager) {
+  manager->n_sweeps = 0;
+  for (size_t i = 0; i < list_size(manager->bodies); i++) {
+    body_t *body = list_get(manager->bodies, i);
+    if (body_is_removed(body))
+      continue;
+    body_handle_t handle = body_pool_get_handle(manager->pool, body);
+    if (handle.index >= manager->starts_capacity) {
+      size_t capacity = manager->starts_capacity == 0
+                            ? PAIR_MANAGER_INITIAL_CAPACITY
+                            : manager->starts_capacity;
+      while (capacity <= handle.index)
+        capacity *= 2;
+      manager->starts =
+          realloc(manager->starts, sizeof(body_start_t) * capacity);
+      assert(manager->starts);
+      manager->starts_capacity = capacity;
+    }
+    body_start_t start = {.body = handle, .start = body_get_centroid(body)};
+    manager->starts[handle.index] = start;
+    if (!body_is_bullet(body))
+      continue;
+    if (manager->n_sweeps == manager->sweeps_capacity) {
+      manager->sweeps_capacity = manager->sweeps_capacity == 0
+                                     ? PAIR_MANAGER_INITIAL_CAPACITY
+                                     : 2 * manager->sweeps_capacity;
+      manager->sweeps = realloc(
+          manager->sweeps, sizeof(bullet_sweep_t) * manager->sweeps_capacity);
+      assert(manager->sweeps);
+    }
+    if (handle.index >= manager->sweep_indices_capacity) {
+      size_t capacity = manager->sweep_indices_capacity == 0
+                            ? PAIR_MANAGER_INITIAL_CAPACITY
+                            : manager->sweep_indices_capacity;
+      while (capacity <= handle.index)
+        capacity *= 2;
+      manager->sweep_indices =
+          realloc(manager->sweep_indices, sizeof(size_t) * capacity);
+      assert(manager->sweep_indices);
+      manager->sweep_indices_capacity = capacity;
+    }
+    manager->sweep_indices[handle.index] = manager->n_sweeps;
+    bullet_sweep_t *sweep = &manager->sweeps[manager->n_sweeps++];
+    sweep->body = handle;
+    sweep->start = body_get_centroid(body);
+    sweep->moving = false;
+    sweep->impact = INFINITY;
+  }
+}
+
+/**
+ * Finds the saved sweep of a body, or returns NULL if it is not a bullet
+ * that moved far enough to be swept.
+ */
+bullet_sweep_t *pair_manager_find_sweep(pair_manager_t *manager,
+                                        body_handle_t handle) {
+  if (handle.index >= manager->sweep_indices_capacity)
+    return NULL;
+  size_t index = manager->sweep_indices[handle.index];
+  if (index >= manager->n_sweeps ||
+      !handles_equal(manager->sweeps[index].body, handle) ||
+      !manager->sweeps[index].moving)
+    return NULL;
+  return &manager->sweeps[index];
+}
+
+/**
+ * Gets how far a body moved since pair_manager_save_bullets(),
+ * or VEC_ZERO if it was not saved.
+ */
+vector_t pair_manager_find_displacement(pair_manager_t *manager,
+                                        body_handle_t handle, body_t *body) {
+  if (handle.index >= manager->starts_capacity ||
+      !handles_equal(manager->starts[handle.index].body, handle))
+    return VEC_ZERO;
+  return vec_subtract(body_get_centroid(body),
+                      manager->starts[handle.index].start);
+}
+
+/**
+ * Grows a body's bounding box back along its displacement,
+ * to cover its motion over the tick.
+ */
+aabb_t aabb_sweep(aabb_t box, vector_t displacement) {
+  aabb_t result = {
+      .min = {.x = fmin(box.min.x, box.min.x - displacement.x),
+              .y = fmin(box.min.y, box.min.y - displacement.y)},
+      .max = {.x = fmax(box.max.x, box.max.x - displacement.x),
+              .y = fmax(box.max.y, box.max.y - displacement.y)}};
+  return result;
+}
+
+/**
+ * Measures how far a bullet moved during the tick, and decides whether it
+ * moved far enough to be swept.
+ */
+void bullet_sweep_measure(bullet_sweep_t *sweep, body_t *body) {
+  aabb_t box = body_get_aabb(body);
+  vector_t displacement = vec_subtract(body_get_centroid(body), sweep->start);
+  double extent = fmin(box.max.x - box.min.x, box.max.y - box.min.y);
+  double threshold = SWEEP_MOTION_THRESHOLD * extent;
+  sweep->moving = vec_dot(displacement, displacement) > threshold * threshold;
+  sweep->displacement = displacement;
+  sweep->swept = aabb_sweep(box, displacement);
+}
+
+/**
+ * Sweeps a bullet against another body of a pair, held where it ended the
+ * tick, with the bullet's displacement relative to it, and records the
+ * impact if the bullet passed into the body without ending inside it.
+ */
+void bullet_sweep_pair(bullet_sweep_t *sweep, body_t *bullet, body_t *body,
+                       body_handle_t handle, vector_t displacement) {
+  shape_view_t bullet_view = body_get_shape_view(bullet);
+  shape_view_t body_view = body_get_shape_view(body);
+  double impact = find_time_of_impact(bullet_view, displacement, body_view);
+  // Bodies overlapping from the start are left to the ordinary collision
+  if (impact <= 0 || impact >= sweep->impact)
+    return;
+  if (find_collision_view(bullet_view, body_view).collided)
+    return;
+  sweep->impact = impact;
+  sweep->impact_body = handle;
+  sweep->impact_displacement = displacement;
+}
+
+void pair_manager_sweep_bullets(pair_manager_t *manager) {
+  bool any_moving = false;
+  for (size_t i = 0; i < manager->n_sweeps; i++) {
+    bullet_sweep_t *sweep = &manager->sweeps[i];
+    bullet_sweep_measure(sweep,
+                         body_pool_resolve(manager->pool, sweep->body));
+    any_moving = any_moving || sweep->moving;
+  }
+  if (!any_moving) {
+    manager->n_sweeps = 0;
+    return;
+  }
+
+  for (size_t i = 0; i < manager->capacity; i++) {
+    collision_pair_t *pair = manager->table[i];
+    if (pair == NULL)
+      continue;
+    bullet_sweep_t *sweep1 = pair_manager_find_sweep(manager, pair->body1);
+    bullet_sweep_t *sweep2 = pair_manager_find_sweep(manager, pair->body2);
+    if (sweep1 == NULL && sweep2 == NULL)
+      continue;
+    body_t *body1 = body_pool_resolve(manager->pool, pair->body1);
+    body_t *body2 = body_pool_resolve(manager->pool, pair->body2);
+    if (body1 == NULL || body2 == NULL)
+      continue;
+    vector_t displacement1 =
+        sweep1 != NULL
+            ? sweep1->displacement
+            : pair_manager_find_displacement(manager, pair->body1, body1);
+    vector_t displacement2 =
+        sweep2 != NULL
+            ? sweep2->displacement
+            : pair_manager_find_displacement(manager, pair->body2, body2);
+    if (!aabb_overlaps(aabb_sweep(body_get_aabb(body1), displacement1),
+                       aabb_sweep(body_get_aabb(body2), displacement2)))
+      continue;
+    // Each body is swept relative to the other
+    vector_t displacement = vec_subtract(displacement1, displacement2);
+    if (sweep1 != NULL)
+      bullet_sweep_pair(sweep1, body1, body2, pair->body2, displacement);
+    if (sweep2 != NULL)
+      bullet_sweep_pair(sweep2, body2, body1, pair->body1,
+                        vec_negate(displacement));
+  }
+
+  // The impacts were found with the bodies hit held where they ended the
+  // tick, so each bullet is moved back along its motion relative to the body
+  // it hit, to start + fraction * its displacement + (1 - fraction) * the
+  // body's displacement. Two bullets that hit each other first are both
+  // moved back to the fraction at which they met instead.
+  for (size_t i = 0; i < manager->n_sweeps; i++) {
+    bullet_sweep_t *sweep = &manager->sweeps[i];
+    if (sweep->impact == INFINITY)
+      continue;
+    vector_t relative = sweep->impact_displacement;
+    double length = sqrt(vec_dot(relative, relative));
+    double fraction = fmin(sweep->impact + SWEEP_CONTACT_DEPTH / length, 1);
+    bullet_sweep_t *other =
+        pair_manager_find_sweep(manager, sweep->impact_body);
+    bool mutual = other != NULL && other->impact != INFINITY &&
+                  handles_equal(other->impact_body, sweep->body);
+    sweep->correction =
+        vec_multiply(fraction - 1, mutual ? sweep->displacement : relative);
+  }
+  for (size_t i = 0; i < manager->n_sweeps; i++) {
+    bullet_sweep_t *sweep = &manager->sweeps[i];
+    if (sweep->impact == INFINITY)
+      continue;
+    vector_t correction = sweep->correction;
+    // A bullet follows the bullet it hit if that one is moved back for
+    // hitting something else first
+    bullet_sweep_t *other =
+        pair_manager_find_sweep(manager, sweep->impact_body);
+    if (other != NULL && other->impact != INFINITY &&
+        !handles_equal(other->impact_body, sweep->body))
+      correction = vec_add(correction, other->correction);
+    vector_t end = vec_add(sweep->start, sweep->displacement);
+    body_set_centroid(body_pool_resolve(manager->pool, sweep->body),
+                      vec_add(end, correction));
+  }
+  manager->n_sweeps = 0;
+}
+
+void narrowphase_cache_insert(pair_manager_t *manager,
+                              narrowphase_entry_t entry);
+
+/**
+ * Grows the narrowphase cache so it stays at most half full,
+ * keeping the results of the current tick.
+ */
+void narrowphase_cache_reserve(pair_manager_t *manager, size_t n_cached) {
+  if (2 * n_cached <= manager->cache_capacity)
+    return;
+  narrowphase_entry_t *old_cache = manager->cache;
+  size_t old_capacity = manager->cache_capacity;
+  size_t capacity =
+      old_capacity == 0 ? PAIR_MANAGER_INITIAL_CAPACITY : old_capacity;
+  while (capacity < 2 * n_cached)
+    capacity *= 2;
+  manager->cache = calloc(capacity, sizeof(narrowphase_entry_t));
+  assert(manager->cache);
+  manager->cache_capacity = capacity;
+  manager->n_cached = 0;
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_cache[i].stamp == manager->stamp)
+      narrowphase_cache_insert(manager, old_cache[i]);
+  }
+  free(old_cache);
+}
+
+/**
+ * Finds the cache entry for the pair of two handles in the current tick,
+ * or the empty entry where it would be inserted.
+ */
+narrowphase_entry_t *narrowphase_cache_find(pair_manager_t *manager,
+                                            body_handle_t handle1,
+                                            body_handle_t handle2) {
+  size_t mask = manager->cache_capacity - 1;
+  size_t i = pair_manager_hash(handle1, handle2) & mask;
+  while (manager->cache[i].stamp == manager->stamp) {
+    narrowphase_entry_t *entry = &manager->cache[i];
+    if ((handles_equal(entry->body1, handle1) &&
+         handles_equal(entry->body2, handle2)) ||
+        (handles_equal(entry->body1, handle2) &&
+         handles_equal(entry->body2, handle1)))
+      return entry;
+    i = (i + 1) & mask;
+  }
+  return &manager->cache[i];
+}
+
+void narrowphase_cache_insert(pair_manager_t *manager,
+                              narrowphase_entry_t entry) {
+  narrowphase_cache_reserve(manager, manager->n_cached + 1);
+  narrowphase_entry_t *slot =
+      narrowphase_cache_find(manager, entry.body1, entry.body2);
+  if (slot->stamp != manager->stamp)
+    manager->n_cached++;
+  *slot = entry;
+}
+
+/**
+ * Tests two bodies whose bounding boxes are known to overlap for a
+ * collision, through the narrowphase cache.
+ */
+collision_info_t pair_manager_narrowphase(pair_manager_t *manager,
+                                          body_t *body1, body_t *body2) {
+  body_handle_t handle1 = body_pool_get_handle(manager->pool, body1);
+  body_handle_t handle2 = body_pool_get_handle(manager->pool, body2);
+  uint32_t version1 = body_get_geometry_version(body1);
+  uint32_t version2 = body_get_geometry_version(body2);
+  // Bodies outside the pool have no handles to remember their result by
+  bool memoize = body_handle_is_valid(manager->pool, handle1) &&
+                 body_handle_is_valid(manager->pool, handle2);
+  if (memoize && manager->cache_capacity > 0) {
+    narrowphase_entry_t *entry =
+        narrowphase_cache_find(manager, handle1, handle2);
+    if (entry->stamp == manager->stamp) {
+      bool swapped = !handles_equal(entry->body1, handle1);
+      if (entry->version1 == (swapped ? version2 : version1) &&
+          entry->version2 == (swapped ? version1 : version2)) {
+        collision_info_t result = entry->collision;
+        if (swapped && result.collided)
+          result.axis = vec_negate(result.axis);
+        return result;
+      }
+    }
+  }
+
+  collision_info_t result = find_collision_view(body_get_shape_view(body1),
+                                                body_get_shape_view(body2));
+  if (!memoize)
+    return result;
+  narrowphase_entry_t entry = {.body1 = handle1,
+                               .body2 = handle2,
+                               .version1 = version1,
+                               .version2 = version2,
+                               .stamp = manager->stamp,
+                               .collision = result};
+  narrowphase_cache_insert(manager, entry);
+  return result;
+}
+
+collision_info_t pair_manager_find_collision(pair_manager_t *manager,
+                                             body_t *body1, body_t *body2) {
+  if (!aabb_overlaps(body_get_aabb(body1), body_get_aabb(body2))) {
+    collision_info_t result = {.collided = false};
+    return result;
+  }
+  return pair_manager_narrowphase(manager, body1, body2);
+}
+
+void pair_manager_next_tick(pair_manager_t *manager) {
+  manager->stamp++;
+  if (manager->stamp == 0) {
+    // The stamp wrapped around, so old entries could look current again
+    for (size_t i = 0; i < manager->cache_capacity; i++)
+      manager->cache[i].stamp = 0;
+    manager->stamp = 1;
+  }
+  manager->n_cached = 0;
+}
+
+pair_state_t pair_manager_get_state(pair_manager_t *manager, body_t *body1,
+                                    body_t *body2) {
+  body_handle_t handle1 = body_pool_get_handle(manager->pool, body1);
+  body_handle_t handle2 = body_pool_get_handle(manager->pool, body2);
+  if (!body_handle_is_valid(manager->pool, handle1) ||
+      !body_handle_is_valid(manager->pool, handle2))
+    return PAIR_SEPARATED;
+  collision_pair_t *pair =
+      manager->table[pair_manager_find(manager, handle1, handle2)];
+  return pair == NULL ? PAIR_SEPARATED : pair->state;
+}
+
+/**
+ * Tests a pair once, advances its contact state, and calls its handlers.
+ * Does nothing if either body has been removed.
+ */
+void collision_pair_update(collision_pair_t *pair) {
+  pair_manager_t *manager = pair->manager;
+  bool is_candidate = pair->is_candidate;
+  pair->is_candidate = false;
+  body_t *body1 = body_pool_resolve(manager->pool, pair->body1);
+  body_t *body2 = body_pool_resolve(manager->pool, pair->body2);
+  if (body1 == NULL || body2 == NULL)
+    return;
+
+  // The boxes of candidates overlapped when the broadphase found them,
+  // but a pair queued only for having been active may have come apart
+  collision_info_t collision =
+      is_candidate ? pair_manager_narrowphase(manager, body1, body2)
+                   : pair_manager_find_collision(manager, body1, body2);
+  bool was_colliding =
+      pair->state == PAIR_BEGIN || pair->state == PAIR_PERSIST;
+  if (collision.collided)
+    pair->state = was_colliding ? PAIR_PERSIST : PAIR_BEGIN;
+  else
+    pair->state = was_colliding ? PAIR_END : PAIR_SEPARATED;
+  if (pair->solid && collision.collided)
+    pair_manager_add_contact(manager, pair, collision);
+
+  // Handlers may register more handlers on this pair, which run this update
+  for (size_t i = 0; i < pair->n_handlers; i++) {
+    pair_handler_entry_t entry = pair->handlers[i];
+    pair->handlers[i].is_new = false;
+    if (!collision.collided ||
+        !(entry.persistent || entry.is_new || pair->state == PAIR_BEGIN))
+      continue;
+    if (entry.swapped)
+      entry.handler(body2, body1, vec_negate(collision.axis), entry.aux);
+    else
+      entry.handler(body1, body2, collision.axis, entry.aux);
+  }
+}
+
+/**
+ * Queues a pair for the current update pass, unless it is already queued.
+ */
+void pair_manager_queue_update(pair_manager_t *manager,
+                               collision_pair_t *pair) {
+  if (pair->pass == manager->pass)
+    return;
+  pair->pass = manager->pass;
+  pair_array_add(&manager->updates, &manager->n_updates,
+                 &manager->updates_capacity, pair);
+}
+
+/**
+ * Queues the pair of two bodies reported by the broadphase, if they have one.
+ */
+void pair_manager_candidate_found(void *aux, body_handle_t handle1,
+                                  body_handle_t handle2) {
+  pair_manager_t *manager = (pair_manager_t *)aux;
+  collision_pair_t *pair =
+      manager->table[pair_manager_find(manager, handle1, handle2)];
+  if (pair == NULL)
+    return;
+  pair->is_candidate = true;
+  pair_manager_queue_update(manager, pair);
+}
+
+/**
+ * Orders pairs by when they were added.
+ */
+int collision_pair_compare_order(const void *a, const void *b) {
+  size_t order1 = (*(collision_pair_t *const *)a)->order;
+  size_t order2 = (*(collision_pair_t *const *)b)->order;
+  return order1 < order2 ? -1 : order1 > order2;
+}
+
+/**
+ * Closes the gaps freed pairs left in the ordered pairs once they make up
+ * half of it, keeping the order.
+ */
+void pair_manager_compact(pair_manager_t *manager) {
+  if (2 * manager->n_freed <= manager->n_ordered)
+    return;
+  size_t n_kept = 0;
+  for (size_t i = 0; i < manager->n_ordered; i++) {
+    collision_pair_t *pair = manager->ordered[i];
+    if (pair == NULL)
+      continue;
+    pair->order = n_kept;
+    manager->ordered[n_kept++] = pair;
+  }
+  manager->n_ordered = n_kept;
+  manager->n_freed = 0;
+}
+
+/**
+ * Starts a new update pass, so no pair counts as queued.
+ */
+void pair_manager_next_pass(pair_manager_t *manager) {
+  manager->pass++;
+  if (manager->pass == 0) {
+    // The pass wrapped around, so old passes could look current again
+    for (size_t i = 0; i < manager->n_ordered; i++) {
+      if (manager->ordered[i] != NULL)
+        manager->ordered[i]->pass = 0;
+    }
+    manager->pass = 1;
+  }
+  manager->n_updates = 0;
+}
+
+void pair_manager_update(pair_manager_t *manager) {
+  pair_manager_compact(manager);
+  pair_manager_next_pass(manager);
+  if (broadphase_get_kind(manager->broadphase) == BROADPHASE_NONE) {
+    for (size_t i = 0; i < manager->n_ordered; i++) {
+      if (manager->ordered[i] != NULL)
+        pair_manager_queue_update(manager, manager->ordered[i]);
+    }
+  } else {
+    if (manager->n_pairs > 0)
+      broadphase_find_pairs(manager->broadphase, manager->bodies,
+                            pair_manager_candidate_found, manager);
+    // Pairs whose boxes stopped overlapping still need to see it
+    for (size_t i = 0; i < manager->n_active; i++)
+      pair_manager_queue_update(manager, manager->active[i]);
+    // Update in a fixed order, whatever order the broadphase found them in
+    qsort(manager->updates, manager->n_updates, sizeof(collision_pair_t *),
+          collision_pair_compare_order);
+  }
+
+  for (size_t i = 0; i < manager->n_active; i++)
+    manager->active[i]->active_index = PAIR_NOT_ACTIVE;
+  manager->n_active = 0;
+  for (size_t i = 0; i < manager->n_updates; i++) {
+    collision_pair_t *pair = manager->updates[i];
+    collision_pair_update(pair);
+    if (pair->state != PAIR_SEPARATED) {
+      pair->active_index = manager->n_active;
+      pair_array_add(&manager->active, &manager->n_active,
+                     &manager->active_capacity, pair);
+    }
+  }
+}
+
+/**
+ * Removes a pair from its manager and frees it with the auxiliary values
+ * of its handlers.
+ */
+void collision_pair_free(collision_pair_t *pair) {
+  pair_manager_t *manager = pair->manager;
+  size_t mask = manager->capacity - 1;
+  size_t i = pair_manager_find(manager, pair->body1, pair->body2);
+  assert(manager->table[i] == pair);
+  // Shift later pairs of the probe sequence back into the hole,
+  // so lookups never stop early at it
+  size_t j = i;
+  while (true) {
+    j = (j + 1) & mask;
+    collision_pair_t *next = manager->table[j];
+    if (next == NULL)
+      break;
+    size_t home = pair_manager_hash(next->body1, next->body2) & mask;
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      manager->table[i] = next;
+      i = j;
+    }
+  }
+  manager->table[i] = NULL;
+  manager->n_pairs--;
+
+  manager->ordered[pair->order] = NULL;
+  manager->n_freed++;
+  if (pair->active_index != PAIR_NOT_ACTIVE) {
+    collision_pair_t *last = manager->active[--manager->n_active];
+    manager->active[pair->active_index] = last;
+    last->active_index = pair->active_index;
+  }
+  pair_manager_unlink_pair(manager, pair->body1.index, pair);
+  pair_manager_unlink_pair(manager, pair->body2.index, pair);
+
+  for (size_t k = 0; k < pair->n_handlers; k++) {
+    if (pair->handlers[k].freer != NULL)
+      pair->handlers[k].freer(pair->handlers[k].aux);
+  }
+  free(pair->handlers);
+  free(pair);
+}
+
+void pair_manager_remove_body(pair_manager_t *manager, body_handle_t handle) {
+  if (handle.index >= manager->body_pairs_capacity ||
+      manager->body_pairs[handle.index] == NULL)
+    return;
+  list_t *pairs = manager->body_pairs[handle.index];
+  while (list_size(pairs) > 0)
+    collision_pair_free(list_get(pairs, list_size(pairs) - 1));
+}
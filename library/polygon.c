@@ -10,6 +10,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+// Relative error allowed in the edges of a polygon detected as a rectangle
+const double RECTANGLE_TOLERANCE = 1e-9;
+// Sine of the angle a polygon detected as convex may turn the wrong way by
+const double CONVEXITY_TOLERANCE = 1e-9;
+// tan(pi / 8), which splits each octant of directions in half
+const double TAN_PI_OVER_8 = 0.41421356237309503;
+
 const vector_t VELOCITY = {.x = 200, .y = 0};
 const size_t SIDE_LENGTH = 100;
 const double PI = 3.14159;
@@ -84,6 +91,16 @@ double polygon_area(list_t *polygon) {
   return fabs(0.5 * sum);
 }
 
+double polygon_area_array(const vector_t *points, size_t size) {
+  double sum = 0;
+  for (size_t i = 1; i < size + 1; i++) {
+    const vector_t *first = &points[i - 1];
+    const vector_t *second = &points[i % size];
+    sum += (second->x + first->x) * (second->y - first->y);
+  }
+  return fabs(0.5 * sum);
+}
+
 vector_t polygon_centroid(list_t *polygon) {
   double x = 0;
   double y = 0;
@@ -100,6 +117,194 @@ vector_t polygon_centroid(list_t *polygon) {
   return answer;
 }
 
+vector_t polygon_centroid_array(const vector_t *points, size_t size) {
+  double x = 0;
+  double y = 0;
+  for (size_t i = 0; i < size; i++) {
+    const vector_t *first = &points[i];
+    const vector_t *second = &points[(i + 1) % size];
+    x += (first->x + second->x) * (first->x * second->y - first->y * second->x);
+    y += (first->y + second->y) * (first->x * second->y - first->y * second->x);
+  }
+  double area = polygon_area_array(points, size);
+  x *= 1.0 / (6.0 * area);
+  y *= 1.0 / (6.0 * area);
+  vector_t answer = {.x = x, .y = y};
+  return answer;
+}
+
+double polygon_moment_array(const vector_t *points, size_t size,
+                            vector_t point) {
+  double sum = 0;
+  double signed_area = 0;
+  for (size_t i = 0; i < size; i++) {
+    vector_t first = vec_subtract(points[i], point);
+    vector_t second = vec_subtract(points[(i + 1) % size], point);
+    double cross = vec_cross(first, second);
+    sum += cross * (vec_dot(first, first) + vec_dot(first, second) +
+                    vec_dot(second, second));
+    signed_area += cross;
+  }
+  // Flip the sign for clockwise polygons, whose cross products are negative
+  return signed_area < 0 ? -sum / 12.0 : sum / 12.0;
+}
+
+aabb_t polygon_aabb_array(const vector_t *points, size_t size) {
+  assert(size > 0);
+  aabb_t result = {.min = points[0], .max = points[0]};
+  for (size_t i = 1; i < size; i++) {
+    if (points[i].x < result.min.x)
+      result.min.x = points[i].x;
+    if (points[i].x > result.max.x)
+      result.max.x = points[i].x;
+    if (points[i].y < result.min.y)
+      result.min.y = points[i].y;
+    if (points[i].y > result.max.y)
+      result.max.y = points[i].y;
+  }
+  return result;
+}
+
+vector_t polygon_edge_normal(vector_t point1, vector_t point2) {
+  double x = point1.y - point2.y;
+  double y = point2.x - point1.x;
+  double length = sqrt(x * x + y * y);
+  vector_t result = {.x = x / length, .y = y / length};
+  return result;
+}
+
+void polygon_edge_normals_array(const vector_t *points, size_t size,
+                                vector_t *normals) {
+  for (size_t i = 0; i < size; i++)
+    normals[i] = polygon_edge_normal(points[i], points[(i + 1) % size]);
+}
+
+bool polygon_is_rectangle_array(const vector_t *points, size_t size) {
+  if (size != 4)
+    return false;
+  vector_t edges[4];
+  for (size_t i = 0; i < 4; i++)
+    edges[i] = vec_subtract(points[(i + 1) % 4], points[i]);
+  double length0 = vec_dot(edges[0], edges[0]);
+  double length1 = vec_dot(edges[1], edges[1]);
+  if (length0 == 0 || length1 == 0)
+    return false;
+  vector_t sum02 = vec_add(edges[0], edges[2]);
+  vector_t sum13 = vec_add(edges[1], edges[3]);
+  double dot01 = vec_dot(edges[0], edges[1]);
+  double tolerance = RECTANGLE_TOLERANCE * RECTANGLE_TOLERANCE;
+  return vec_dot(sum02, sum02) <= tolerance * length0 &&
+         vec_dot(sum13, sum13) <= tolerance * length1 &&
+         dot01 * dot01 <= tolerance * length0 * length1;
+}
+
+bool polygon_is_convex_array(const vector_t *points, size_t size) {
+  if (size < 3)
+    return false;
+  bool turns_left = false;
+  bool turns_right = false;
+  bool goes_straight = false;
+  // The edges of a polygon that winds around once point left and right
+  // in one run each
+  size_t direction_changes = 0;
+  double last_x = 0;
+  for (size_t i = 0; i < size; i++) {
+    vector_t edge1 = vec_subtract(points[(i + 1) % size], points[i]);
+    vector_t edge2 =
+        vec_subtract(points[(i + 2) % size], points[(i + 1) % size]);
+    double cross = vec_cross(edge1, edge2);
+    double tolerance = CONVEXITY_TOLERANCE *
+                       sqrt(vec_dot(edge1, edge1) * vec_dot(edge2, edge2));
+    if (cross > tolerance)
+      turns_left = true;
+    else if (cross < -tolerance)
+      turns_right = true;
+    else
+      goes_straight = true;
+    if (edge1.x != 0) {
+      if (last_x != 0 && (edge1.x > 0) != (last_x > 0))
+        direction_changes++;
+      last_x = edge1.x;
+    }
+  }
+  // Count the change between the last edge and the first
+  for (size_t i = 0; i < size; i++) {
+    double x = points[(i + 1) % size].x - points[i].x;
+    if (x != 0) {
+      if ((x > 0) != (last_x > 0))
+        direction_changes++;
+      break;
+    }
+  }
+  return !goes_straight && !(turns_left && turns_right) &&
+         direction_changes <= 2;
+}
+
+/**
+ * Picks which of a view's extreme_hints serves a direction,
+ * by which sixteenth of the circle the direction points into.
+ */
+size_t polygon_extreme_hint_index(vector_t direction) {
+  double x = fabs(direction.x);
+  double y = fabs(direction.y);
+  size_t result = (direction.x < 0) << 3 | (direction.y < 0) << 2;
+  if (y > x)
+    result |= 2 | (x > TAN_PI_OVER_8 * y);
+  else
+    result |= y > TAN_PI_OVER_8 * x;
+  return result;
+}
+
+/**
+ * Projects a vertex of a polygon onto a direction.
+ */
+double polygon_project_vertex(shape_view_t shape, size_t index,
+                              vector_t direction) {
+  return shape.points[index].x * direction.x +
+         shape.points[index].y * direction.y;
+}
+
+size_t polygon_find_extreme(shape_view_t shape, vector_t direction) {
+  assert(shape.size > 0);
+  if (shape.extreme_hints == NULL) {
+    size_t best = 0;
+    double max = polygon_project_vertex(shape, 0, direction);
+    for (size_t i = 1; i < shape.size; i++) {
+      double value = polygon_project_vertex(shape, i, direction);
+      if (value > max) {
+        max = value;
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  size_t *hint = &shape.extreme_hints[polygon_extreme_hint_index(direction)];
+  size_t best = *hint < shape.size ? *hint : 0;
+  double max = polygon_project_vertex(shape, best, direction);
+  // Walk whichever way the projection increases until it stops increasing.
+  // On a convex polygon that is the largest projection, and each step
+  // increases it, so the walk ends within one lap.
+  size_t step = 1;
+  size_t next = best + 1 < shape.size ? best + 1 : 0;
+  double value = polygon_project_vertex(shape, next, direction);
+  if (value <= max) {
+    step = shape.size - 1;
+    next = best > 0 ? best - 1 : shape.size - 1;
+    value = polygon_project_vertex(shape, next, direction);
+  }
+  while (value > max) {
+    best = next;
+    max = value;
+    next = best + step;
+    if (next >= shape.size)
+      next -= shape.size;
+    value = polygon_project_vertex(shape, next, direction);
+  }
+  *hint = best;
+  return best;
+}
+
 void polygon_translate(list_t *polygon, vector_t translation) {
   ssize_t size = list_size(polygon);
   for (ssize_t i = size - 1; i >= 0; i--) {
@@ -120,6 +325,23 @@ void polygon_rotate(list_t *polygon, double angle, vector_t point) {
   }
 }
 
+void polygon_translate_array(vector_t *points, size_t size,
+                             vector_t translation) {
+  for (size_t i = 0; i < size; i++) {
+    points[i].x = points[i].x + translation.x;
+    points[i].y = points[i].y + translation.y;
+  }
+}
+
+void polygon_rotate_array(vector_t *points, size_t size, double angle,
+                          vector_t point) {
+  for (size_t i = 0; i < size; i++) {
+    vector_t vector = {.x = points[i].x - point.x, .y = points[i].y - point.y};
+    vector = vec_rotate(vector, angle);
+    points[i] = vec_add(vector, point);
+  }
+}
+
 vector_t *get_velocity(polygon_t *polygon) { return polygon->velocity; }
 
 rgb_color_t polygon_get_color(polygon_t *polygon) { return polygon->color; }
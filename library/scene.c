@@ -1,7 +1,9 @@
 #include "scene.h"
 #include "body.h"
+#include "broadphase.h"
 #include "forces.h"
 #include "list.h"
+#include "pair_manager.h"
 #include <sdl_wrapper.h>
 #include <assert.h>
 #include <stdbool.h>
@@ -11,10 +13,18 @@
 const size_t NUM_BODIES = 10;
 const size_t NUM_FORCES = 30;
 const int STAR = 15; //enum associated with the star
+const size_t DEFAULT_SOLVER_ITERATIONS = 8;
 
 typedef struct scene {
   list_t *bodies;
+  body_pool_t *pool;
+  broadphase_t *broadphase;
+  pair_manager_t *pairs;
+  size_t solver_iterations;
   list_t *forces;
+  // Maps a body handle's slot index to the list of forces depending on it
+  list_t **body_forces;
+  size_t body_forces_capacity;
   bool game_over;
   bool plant_boy_fertilizer_collected;
   bool dirt_girl_fertilizer_collected;
@@ -28,7 +38,11 @@ typedef struct force {
   force_creator_t force_creator;
   void *aux;
   free_func_t aux_freer;
-  list_t *bodies;
+  // Handles to the bodies the force depends on
+  body_handle_t *handles;
+  size_t n_handles;
+  // Set when one of the bodies is removed; the force is freed that tick
+  bool is_dead;
 } force_t;
 
 force_t *force_init(force_creator_t force_creator, void *aux,
@@ -38,34 +52,115 @@ force_t *force_init(force_creator_t force_creator, void *aux,
   result->force_creator = force_creator;
   result->aux = aux;
   result->aux_freer = aux_freer;
-  result->bodies = NULL;
+  result->handles = NULL;
+  result->n_handles = 0;
+  result->is_dead = false;
   return result;
 }
 
-force_t *force_bodies_init(force_creator_t force_creator, void *aux,
-                           free_func_t aux_freer, list_t *bodies) {
-  force_t *result = malloc(sizeof(force_t));
-  assert(result);
-  result->force_creator = force_creator;
-  result->aux = aux;
-  result->aux_freer = aux_freer;
-  result->bodies = bodies;
+force_t *force_bodies_init(scene_t *scene, force_creator_t force_creator,
+                           void *aux, free_func_t aux_freer, list_t *bodies) {
+  force_t *result = force_init(force_creator, aux, aux_freer);
+  size_t n_bodies = list_size(bodies);
+  if (n_bodies > 0) {
+    result->handles = malloc(sizeof(body_handle_t) * n_bodies);
+    assert(result->handles);
+    for (size_t i = 0; i < n_bodies; i++)
+      result->handles[i] =
+          scene_reserve_body_handle(scene, list_get(bodies, i));
+    result->n_handles = n_bodies;
+  }
   return result;
 }
 
 void force_free(void *to_free) {
   force_t *force = (force_t *)to_free;
-  if (force->bodies != NULL)
-    free(force->bodies);
+  free(force->handles);
   if (force->aux_freer != NULL)
     force->aux_freer(force->aux);
   free(force);
 }
 
+/**
+ * Gets the list of forces depending on the body in a given handle slot,
+ * creating it if needed.
+ */
+list_t *scene_get_body_forces(scene_t *scene, size_t slot) {
+  if (slot >= scene->body_forces_capacity) {
+    size_t capacity = scene->body_forces_capacity * 2;
+    if (capacity <= slot)
+      capacity = slot + 1;
+    scene->body_forces =
+        realloc(scene->body_forces, sizeof(list_t *) * capacity);
+    assert(scene->body_forces);
+    for (size_t i = scene->body_forces_capacity; i < capacity; i++)
+      scene->body_forces[i] = NULL;
+    scene->body_forces_capacity = capacity;
+  }
+  if (scene->body_forces[slot] == NULL)
+    scene->body_forces[slot] = list_init(2, NULL);
+  return scene->body_forces[slot];
+}
+
+/**
+ * Marks every force depending on a removed body as dead
+ * and empties the body's entry in the reverse index.
+ */
+void scene_kill_body_forces(scene_t *scene, size_t slot) {
+  if (slot >= scene->body_forces_capacity || scene->body_forces[slot] == NULL)
+    return;
+  list_t *forces = scene->body_forces[slot];
+  for (size_t i = 0; i < list_size(forces); i++) {
+    force_t *force = list_get(forces, i);
+    force->is_dead = true;
+  }
+  list_clear(forces);
+}
+
+/**
+ * Removes a dead force from the reverse index entries of its surviving bodies.
+ */
+void scene_unlink_force(scene_t *scene, force_t *force) {
+  for (size_t i = 0; i < force->n_handles; i++) {
+    body_handle_t handle = force->handles[i];
+    if (!body_handle_is_valid(scene->pool, handle))
+      continue;
+    list_t *forces = scene->body_forces[handle.index];
+    for (size_t j = 0; j < list_size(forces); j++) {
+      if (list_get(forces, j) == force) {
+        list_swap_remove(forces, j);
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * Predicate for list_remove_if() selecting dead forces.
+ * Unlinks each selected force from the reverse index before it is freed.
+ */
+bool scene_force_is_dead(void *force, void *scene) {
+  force_t *f = (force_t *)force;
+  if (f->is_dead)
+    scene_unlink_force((scene_t *)scene, f);
+  return f->is_dead;
+}
+
+bool scene_body_is_removed(void *body, void *aux) {
+  return body_is_removed((body_t *)body);
+}
+
 scene_t *scene_init(void) {
   scene_t *result = malloc(sizeof(scene_t));
   result->bodies = list_init(NUM_BODIES, body_free);
+  result->pool = body_pool_init(NUM_BODIES);
+  result->broadphase = broadphase_init(result->pool, BROADPHASE_GRID);
+  result->pairs =
+      pair_manager_init(result->pool, result->broadphase, result->bodies);
+  result->solver_iterations = DEFAULT_SOLVER_ITERATIONS;
   result->forces = list_init(NUM_FORCES, force_free);
+  result->body_forces = NULL;
+  result->body_forces_capacity = 0;
   result->game_over = false;
   result->plant_boy_fertilizer_collected = false;
   result->dirt_girl_fertilizer_collected = false;
@@ -79,8 +174,16 @@ scene_t *scene_init(void) {
 
 void scene_free(void *to_free) {
   scene_t *scene = (scene_t *)to_free;
-  list_free(scene->bodies);
   list_free(scene->forces);
+  pair_manager_free(scene->pairs);
+  broadphase_free(scene->broadphase);
+  body_pool_free(scene->pool);
+  list_free(scene->bodies);
+  for (size_t i = 0; i < scene->body_forces_capacity; i++) {
+    if (scene->body_forces[i] != NULL)
+      list_free(scene->body_forces[i]);
+  }
+  free(scene->body_forces);
   free(scene);
 }
 
@@ -93,6 +196,34 @@ body_t *scene_get_body(scene_t *scene, size_t index) {
 
 void scene_add_body(scene_t *scene, body_t *body) {
   list_add(scene->bodies, body);
+  body_pool_add(scene->pool, body);
+}
+
+body_handle_t scene_get_body_handle(scene_t *scene, body_t *body) {
+  return body_pool_get_handle(scene->pool, body);
+}
+
+body_handle_t scene_reserve_body_handle(scene_t *scene, body_t *body) {
+  return body_pool_reserve_handle(scene->pool, body);
+}
+
+body_t *scene_resolve_body(scene_t *scene, body_handle_t handle) {
+  return body_pool_resolve(scene->pool, handle);
+}
+
+void scene_set_broadphase(scene_t *scene, broadphase_kind_t kind) {
+  broadphase_set_kind(scene->broadphase, kind);
+}
+
+collision_info_t scene_find_collision(scene_t *scene, body_t *body1,
+                                      body_t *body2) {
+  return pair_manager_find_collision(scene->pairs, body1, body2);
+}
+
+list_t *scene_query_region(scene_t *scene, aabb_t region) {
+  list_t *result = list_init(NUM_BODIES, NULL);
+  broadphase_query_region(scene->broadphase, scene->bodies, region, result);
+  return result;
 }
 
 void scene_remove_body(scene_t *scene, size_t index) {
@@ -108,28 +239,38 @@ void scene_tick(scene_t *scene, double dt) {
       apply_force(force->aux);
     }
   }
-
+  pair_manager_update(scene->pairs);
+
+  pair_manager_solve_contacts(scene->pairs, dt, scene->solver_iterations);
+  pair_manager_correct_positions(scene->pairs);
+  pair_manager_save_bullets(scene->pairs);
+  body_pool_tick(scene->pool, dt);
+  pair_manager_sweep_bullets(scene->pairs);
+  // Every body may have moved, so the next region query rebuilds
+  // and no earlier narrowphase result can be reused
+  broadphase_invalidate(scene->broadphase);
+  pair_manager_next_tick(scene->pairs);
+
+  size_t n_removed = 0;
   for (size_t j = 0; j < list_size(scene->bodies); j++) {
     body_t *body = list_get(scene->bodies, j);
-    body_tick(body, dt);
     if (body_is_removed(body)) {
-      for (size_t k = 0; k < list_size(scene->forces); k++) {
-        force_t *force = list_get(scene->forces, k);
-        list_t *bodies = force->bodies;
-        if (list_contains(bodies, body)) {
-          if (force != NULL) {
-            force_free(list_remove(scene->forces, k));
-            k--;
-          }
-        }
-      }
-      list_remove(scene->bodies, j);
-      j--;
+      body_handle_t handle = body_pool_get_handle(scene->pool, body);
+      // Invalidates the body's handles before its forces are unlinked
+      body_pool_remove(scene->pool, body);
+      scene_kill_body_forces(scene, handle.index);
+      pair_manager_remove_body(scene->pairs, handle);
+      n_removed++;
       if (body_is_player(body) == false)
         exit(0);
-      body_free(body);
     }
   }
+  if (n_removed == 0)
+    return;
+
+  // Compact both lists in a single stable pass each
+  list_remove_if(scene->forces, scene_force_is_dead, scene);
+  list_remove_if(scene->bodies, scene_body_is_removed, NULL);
 }
 
 void scene_add_force_creator(scene_t *scene, force_creator_t force_creator,
@@ -141,10 +282,34 @@ void scene_add_force_creator(scene_t *scene, force_creator_t force_creator,
 void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     void *aux, list_t *bodies,
                                     free_func_t freer) {
-  force_t *force = force_bodies_init(forcer, aux, freer, bodies);
+  force_t *force = force_bodies_init(scene, forcer, aux, freer, bodies);
+  list_free(bodies);
+  for (size_t i = 0; i < force->n_handles; i++)
+    list_add(scene_get_body_forces(scene, force->handles[i].index), force);
   list_add(scene->forces, force);
 }
 
+void scene_add_collision_handler(scene_t *scene, body_t *body1, body_t *body2,
+                                 pair_handler_t handler, void *aux,
+                                 free_func_t freer, bool persistent) {
+  pair_manager_add_handler(scene->pairs, body1, body2, handler, aux, freer,
+                           persistent);
+}
+
+void scene_set_collision_solid(scene_t *scene, body_t *body1, body_t *body2,
+                               double elasticity) {
+  pair_manager_set_solid(scene->pairs, body1, body2, elasticity);
+}
+
+void scene_set_solver_iterations(scene_t *scene, size_t iterations) {
+  scene->solver_iterations = iterations;
+}
+
+pair_state_t scene_get_collision_state(scene_t *scene, body_t *body1,
+                                       body_t *body2) {
+  return pair_manager_get_state(scene->pairs, body1, body2);
+}
+
 size_t scene_forces(scene_t *scene) { return list_size(scene->forces); }
 
 void scene_set_game_over(scene_t *scene, bool value) {
@@ -220,8 +220,8 @@ void sdl_clear(void) {
   SDL_RenderClear(renderer);
 }
 
-void sdl_draw_polygon(list_t *points, rgb_color_t color) {
-  size_t n = list_size(points);
+void sdl_draw_shape(shape_view_t shape, rgb_color_t color) {
+  size_t n = shape.size;
   assert(n >= 3);
   assert(0 <= color.r && color.r <= 1);
   assert(0 <= color.g && color.g <= 1);
@@ -235,8 +235,7 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
   assert(x_points != NULL);
   assert(y_points != NULL);
   for (size_t i = 0; i < n; i++) {
-    vector_t *vertex = list_get(points, i);
-    vector_t pixel = get_window_position(*vertex, window_center);
+    vector_t pixel = get_window_position(shape.points[i], window_center);
     x_points[i] = pixel.x;
     y_points[i] = pixel.y;
   }
@@ -248,6 +247,18 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
   free(y_points);
 }
 
+void sdl_draw_polygon(list_t *points, rgb_color_t color) {
+  size_t n = list_size(points);
+  vector_t *vertices = malloc(sizeof(*vertices) * n);
+  assert(vertices != NULL);
+  for (size_t i = 0; i < n; i++) {
+    vertices[i] = *(vector_t *)list_get(points, i);
+  }
+  shape_view_t shape = {.points = vertices, .size = n};
+  sdl_draw_shape(shape, color);
+  free(vertices);
+}
+
 void sdl_show(void) {
   // Draw boundary lines
   vector_t window_center = get_window_center();
@@ -318,7 +329,6 @@ void sdl_render_scene(scene_t *scene) {
   size_t body_count = scene_bodies(scene);
   for (size_t i = 0; i < body_count; i++) {
     body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
     vector_t centroid = body_get_centroid(body);
     vector_t window = get_window_position(centroid, get_window_center());
 
@@ -348,8 +358,7 @@ void sdl_render_scene(scene_t *scene) {
       star_of_mastery_rect.x = window.x - SCENE_SCALE * get_scene_scale(get_window_center());
       star_of_mastery_rect.y = window.y - SCENE_SCALE * get_scene_scale(get_window_center());
     }
-    sdl_draw_polygon(shape, body_get_color(body));
-    list_free(shape);
+    sdl_draw_shape(body_get_shape_view(body), body_get_color(body));
   }
 
   // BACKGROUND IMAGE
@@ -0,0 +1,168 @@
+#include "body.h"
+#include "scene.h"
+#include "test_util.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Checks the body pool: that its vector kernels integrate exactly like
+ * body_tick(), how handles to bodies are taken, and that they stop
+ * resolving once their bodies are removed, even after their slots are reused.
+ * The Makefile also builds this suite for AVX2 if the CPU supports it, so
+ * each available kernel of body_pool_tick() is checked.
+ */
+
+const rgb_color_t TEST_COLOR = {0, 0, 0};
+const size_t TEST_CIRCLE_POINTS = 12;
+const double TEST_DT = 0.01;
+const unsigned TEST_SEED = 1;
+// Odd, so the AVX kernel also integrates a body on its own
+const size_t TEST_POOL_BODIES = 9;
+const size_t TEST_TICKS = 20;
+
+// The collision handlers play sounds; the tests are silent
+int load_sound_effect(char *filename) { return 0; }
+
+char *get_sound_effect(void *sound) { return NULL; }
+
+double rand_range(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+vector_t rand_vector(double magnitude) {
+  return (vector_t){rand_range(-magnitude, magnitude),
+                    rand_range(-magnitude, magnitude)};
+}
+
+body_t *make_circle(vector_t center) {
+  return body_init_circle(center, 10, TEST_CIRCLE_POINTS, 1, TEST_COLOR);
+}
+
+/**
+ * Asserts that two vectors have exactly the same bits.
+ */
+void assert_same_bits(vector_t v1, vector_t v2) {
+  assert(memcmp(&v1, &v2, sizeof(vector_t)) == 0);
+}
+
+void test_pool_tick_matches_body_tick() {
+  srand(TEST_SEED);
+  body_pool_t *pool = body_pool_init(TEST_POOL_BODIES);
+  body_t *pooled[TEST_POOL_BODIES];
+  body_t *alone[TEST_POOL_BODIES];
+  for (size_t i = 0; i < TEST_POOL_BODIES; i++) {
+    vector_t center = rand_vector(100);
+    // One body is static, with an inverse mass of 0
+    double mass = i == 3 ? INFINITY : rand_range(0.1, 10);
+    vector_t velocity = rand_vector(50);
+    pooled[i] = body_init_circle(center, 5, TEST_CIRCLE_POINTS, mass,
+                                 TEST_COLOR);
+    alone[i] = body_init_circle(center, 5, TEST_CIRCLE_POINTS, mass,
+                                TEST_COLOR);
+    body_set_velocity(pooled[i], velocity);
+    body_set_velocity(alone[i], velocity);
+    body_pool_add(pool, pooled[i]);
+  }
+
+  for (size_t tick = 0; tick < TEST_TICKS; tick++) {
+    for (size_t i = 0; i < TEST_POOL_BODIES; i++) {
+      vector_t force = rand_vector(1000);
+      vector_t impulse = tick % 3 == 0 ? rand_vector(10) : VEC_ZERO;
+      body_add_force(pooled[i], force);
+      body_add_force(alone[i], force);
+      body_add_impulse(pooled[i], impulse);
+      body_add_impulse(alone[i], impulse);
+    }
+    body_pool_tick(pool, TEST_DT);
+    for (size_t i = 0; i < TEST_POOL_BODIES; i++) {
+      body_tick(alone[i], TEST_DT);
+      assert_same_bits(body_get_centroid(pooled[i]),
+                       body_get_centroid(alone[i]));
+      assert_same_bits(body_get_velocity(pooled[i]),
+                       body_get_velocity(alone[i]));
+      assert_same_bits(body_get_force(pooled[i]), body_get_force(alone[i]));
+      assert_same_bits(body_get_impulse(pooled[i]),
+                       body_get_impulse(alone[i]));
+    }
+  }
+
+  for (size_t i = 0; i < TEST_POOL_BODIES; i++) {
+    body_pool_remove(pool, pooled[i]);
+    body_free(pooled[i]);
+    body_free(alone[i]);
+  }
+  body_pool_free(pool);
+}
+
+void test_lookup_does_not_reserve() {
+  body_pool_t *pool = body_pool_init(1);
+  body_t *body = make_circle(VEC_ZERO);
+  body_handle_t handle = body_pool_get_handle(pool, body);
+  assert(!body_handle_is_valid(pool, handle));
+  assert(body_pool_resolve(pool, handle) == NULL);
+
+  // Reserving gives the body a slot before it is added, and the same handle
+  // is looked up once it is
+  handle = body_pool_reserve_handle(pool, body);
+  assert(body_pool_resolve(pool, handle) == body);
+  body_pool_add(pool, body);
+  body_handle_t added = body_pool_get_handle(pool, body);
+  assert(added.index == handle.index && added.generation == handle.generation);
+  assert(body_pool_size(pool) == 1);
+  body_pool_remove(pool, body);
+  assert(!body_handle_is_valid(pool, handle));
+  assert(!body_handle_is_valid(pool, body_pool_get_handle(pool, body)));
+
+  // A reserved slot is released when its body is freed without being added
+  body_t *other = make_circle(VEC_ZERO);
+  body_handle_t reserved = body_pool_reserve_handle(pool, other);
+  body_free(other);
+  assert(!body_handle_is_valid(pool, reserved));
+
+  body_free(body);
+  body_pool_free(pool);
+}
+
+void test_handle_goes_stale_after_removal_and_reuse() {
+  scene_t *scene = scene_init();
+  body_t *first = make_circle(VEC_ZERO);
+  scene_add_body(scene, first);
+  body_handle_t first_handle = scene_get_body_handle(scene, first);
+  assert(scene_resolve_body(scene, first_handle) == first);
+
+  // The body is only removed and freed at the end of the next tick
+  scene_remove_body(scene, 0);
+  assert(scene_resolve_body(scene, first_handle) == first);
+  scene_tick(scene, TEST_DT);
+  assert(scene_bodies(scene) == 0);
+  assert(scene_resolve_body(scene, first_handle) == NULL);
+
+  // The next body reuses the freed slot, under a new generation
+  body_t *second = make_circle(VEC_ZERO);
+  scene_add_body(scene, second);
+  body_handle_t second_handle = scene_get_body_handle(scene, second);
+  assert(second_handle.index == first_handle.index);
+  assert(second_handle.generation != first_handle.generation);
+  assert(scene_resolve_body(scene, first_handle) == NULL);
+  assert(scene_resolve_body(scene, second_handle) == second);
+  scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_pool_tick_matches_body_tick)
+  DO_TEST(test_lookup_does_not_reserve)
+  DO_TEST(test_handle_goes_stale_after_removal_and_reuse)
+
+  puts("body_test PASS");
+}
@@ -0,0 +1,292 @@
+#include "body.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "list.h"
+#include "scene.h"
+#include "test_util.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * Checks that every broadphase reports exactly the pairs of bodies whose
+ * bounding boxes overlap, each once, as bodies move, appear and disappear.
+ * Each test uses a fixed seed, so failures are reproducible.
+ */
+
+const unsigned TEST_SEED = 1;
+const rgb_color_t TEST_COLOR = {0, 0, 0};
+const size_t TEST_CIRCLE_POINTS = 12;
+const size_t TEST_BODIES = 150;
+const size_t TEST_TICKS = 30;
+const size_t TEST_REGIONS = 20;
+const double TEST_WORLD_SIZE = 1000;
+const broadphase_kind_t TEST_KINDS[] = {BROADPHASE_NONE, BROADPHASE_GRID,
+                                        BROADPHASE_SAP, BROADPHASE_TREE};
+#define N_TEST_KINDS (sizeof(TEST_KINDS) / sizeof(TEST_KINDS[0]))
+
+// The collision handlers play sounds; the tests are silent
+int load_sound_effect(char *filename) { return 0; }
+
+char *get_sound_effect(void *sound) { return NULL; }
+
+double rand_range(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+body_t *make_box(vector_t center, double half_width, double half_height,
+                 double mass) {
+  vector_t points[4] = {
+      {.x = center.x - half_width, .y = center.y - half_height},
+      {.x = center.x + half_width, .y = center.y - half_height},
+      {.x = center.x + half_width, .y = center.y + half_height},
+      {.x = center.x - half_width, .y = center.y + half_height}};
+  return body_init_from_array(points, 4, mass, TEST_COLOR);
+}
+
+/**
+ * Makes a random circle or box somewhere in the world. One in twenty is a
+ * long wall, which covers too many grid cells to be inserted into the grid.
+ */
+body_t *make_random_body(double mass) {
+  vector_t center = {.x = rand_range(0, TEST_WORLD_SIZE),
+                     .y = rand_range(0, TEST_WORLD_SIZE)};
+  int kind = rand() % 20;
+  if (kind == 0)
+    return make_box(center, rand_range(200, 500), 5, mass);
+  if (kind < 10)
+    return body_init_circle(center, rand_range(2, 40), TEST_CIRCLE_POINTS,
+                            mass, TEST_COLOR);
+  return make_box(center, rand_range(1, 40), rand_range(1, 40), mass);
+}
+
+/**
+ * Counts how many times each pair of body slots is reported.
+ */
+typedef struct pair_counts {
+  size_t *counts;
+  size_t n_slots;
+} pair_counts_t;
+
+pair_counts_t *pair_counts_init(size_t n_slots) {
+  pair_counts_t *result = malloc(sizeof(pair_counts_t));
+  assert(result);
+  result->counts = calloc(n_slots * n_slots, sizeof(size_t));
+  assert(result->counts);
+  result->n_slots = n_slots;
+  return result;
+}
+
+void pair_counts_free(pair_counts_t *counts) {
+  free(counts->counts);
+  free(counts);
+}
+
+size_t *pair_count(pair_counts_t *counts, uint32_t slot1, uint32_t slot2) {
+  assert(slot1 < counts->n_slots && slot2 < counts->n_slots);
+  if (slot1 > slot2) {
+    uint32_t temp = slot1;
+    slot1 = slot2;
+    slot2 = temp;
+  }
+  return &counts->counts[slot1 * counts->n_slots + slot2];
+}
+
+void count_pair(void *aux, body_handle_t handle1, body_handle_t handle2) {
+  pair_counts_t *counts = (pair_counts_t *)aux;
+  assert(handle1.index != handle2.index);
+  (*pair_count(counts, handle1.index, handle2.index))++;
+}
+
+/**
+ * Asserts that a broadphase reports each pair of bodies whose boxes overlap
+ * exactly once, and no other pairs.
+ */
+void assert_finds_overlapping_pairs(broadphase_t *broadphase,
+                                    body_pool_t *pool, list_t *bodies) {
+  pair_counts_t *counts = pair_counts_init(2 * TEST_BODIES);
+  broadphase_find_pairs(broadphase, bodies, count_pair, counts);
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_t *body1 = list_get(bodies, i);
+    body_handle_t handle1 = body_pool_get_handle(pool, body1);
+    for (size_t j = i + 1; j < list_size(bodies); j++) {
+      body_t *body2 = list_get(bodies, j);
+      body_handle_t handle2 = body_pool_get_handle(pool, body2);
+      size_t expected =
+          aabb_overlaps(body_get_aabb(body1), body_get_aabb(body2)) ? 1 : 0;
+      assert(*pair_count(counts, handle1.index, handle2.index) == expected);
+      *pair_count(counts, handle1.index, handle2.index) = 0;
+    }
+  }
+  // Every pair left over was reported without both bodies being in the list
+  for (size_t i = 0; i < counts->n_slots * counts->n_slots; i++)
+    assert(counts->counts[i] == 0);
+  pair_counts_free(counts);
+}
+
+void test_find_pairs_matches_brute_force() {
+  srand(TEST_SEED);
+  body_pool_t *pool = body_pool_init(TEST_BODIES);
+  list_t *bodies = list_init(TEST_BODIES, NULL);
+  for (size_t i = 0; i < TEST_BODIES; i++) {
+    body_t *body = make_random_body(1);
+    body_pool_add(pool, body);
+    list_add(bodies, body);
+  }
+  broadphase_t *broadphases[N_TEST_KINDS];
+  for (size_t k = 0; k < N_TEST_KINDS; k++)
+    broadphases[k] = broadphase_init(pool, TEST_KINDS[k]);
+
+  for (size_t tick = 0; tick < TEST_TICKS; tick++) {
+    for (size_t k = 0; k < N_TEST_KINDS; k++)
+      assert_finds_overlapping_pairs(broadphases[k], pool, bodies);
+
+    // Most bodies drift a little, and a few jump across the world
+    for (size_t i = 0; i < list_size(bodies); i++) {
+      body_t *body = list_get(bodies, i);
+      vector_t centroid = body_get_centroid(body);
+      if (rand() % 10 == 0) {
+        centroid.x = rand_range(0, TEST_WORLD_SIZE);
+        centroid.y = rand_range(0, TEST_WORLD_SIZE);
+      } else {
+        centroid.x += rand_range(-5, 5);
+        centroid.y += rand_range(-5, 5);
+      }
+      body_set_centroid(body, centroid);
+    }
+    // Some bodies are replaced, so their slots are reused
+    for (size_t n = 0; n < 5; n++) {
+      size_t index = rand() % list_size(bodies);
+      body_t *body = list_get(bodies, index);
+      body_pool_remove(pool, body);
+      body_free(body);
+      list_swap_remove(bodies, index);
+    }
+    for (size_t n = 0; n < 5; n++) {
+      body_t *body = make_random_body(1);
+      body_pool_add(pool, body);
+      list_add(bodies, body);
+    }
+  }
+
+  for (size_t k = 0; k < N_TEST_KINDS; k++)
+    broadphase_free(broadphases[k]);
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_t *body = list_get(bodies, i);
+    body_pool_remove(pool, body);
+    body_free(body);
+  }
+  list_free(bodies);
+  body_pool_free(pool);
+}
+
+void test_tree_skips_static_pairs_until_moved() {
+  body_pool_t *pool = body_pool_init(3);
+  list_t *bodies = list_init(3, NULL);
+  body_t *floor = make_box((vector_t){0, 0}, 100, 10, INFINITY);
+  body_t *wall = make_box((vector_t){90, 50}, 10, 50, INFINITY);
+  body_t *ball = body_init_circle((vector_t){-50, 30}, 10, TEST_CIRCLE_POINTS,
+                                  1, TEST_COLOR);
+  body_t *to_add[] = {floor, wall, ball};
+  for (size_t i = 0; i < 3; i++) {
+    body_pool_add(pool, to_add[i]);
+    list_add(bodies, to_add[i]);
+  }
+  body_handle_t floor_handle = body_pool_get_handle(pool, floor);
+  body_handle_t wall_handle = body_pool_get_handle(pool, wall);
+  body_handle_t ball_handle = body_pool_get_handle(pool, ball);
+
+  for (size_t k = 0; k < N_TEST_KINDS; k++) {
+    broadphase_t *broadphase = broadphase_init(pool, TEST_KINDS[k]);
+    bool skips_static = TEST_KINDS[k] == BROADPHASE_TREE;
+    // New bodies might overlap anything, so the first search finds the pair
+    // of static bodies, and later ones skip it until one of them is moved
+    for (size_t tick = 0; tick < 4; tick++) {
+      if (tick == 2)
+        body_set_centroid(wall, vec_add(body_get_centroid(wall),
+                                        (vector_t){-1, 0}));
+      pair_counts_t *counts = pair_counts_init(3);
+      broadphase_find_pairs(broadphase, bodies, count_pair, counts);
+      size_t expected = skips_static && tick % 2 == 1 ? 0 : 1;
+      assert(*pair_count(counts, floor_handle.index, wall_handle.index) ==
+             expected);
+      assert(*pair_count(counts, floor_handle.index, ball_handle.index) == 0);
+      assert(*pair_count(counts, wall_handle.index, ball_handle.index) == 0);
+      pair_counts_free(counts);
+    }
+    broadphase_free(broadphase);
+  }
+
+  for (size_t i = 0; i < 3; i++) {
+    body_pool_remove(pool, to_add[i]);
+    body_free(to_add[i]);
+  }
+  list_free(bodies);
+  body_pool_free(pool);
+}
+
+/**
+ * Makes a random box of at most a quarter of the world.
+ */
+aabb_t make_random_region(void) {
+  aabb_t result;
+  result.min.x = rand_range(-TEST_WORLD_SIZE / 4, TEST_WORLD_SIZE);
+  result.min.y = rand_range(-TEST_WORLD_SIZE / 4, TEST_WORLD_SIZE);
+  result.max.x = result.min.x + rand_range(0, TEST_WORLD_SIZE / 4);
+  result.max.y = result.min.y + rand_range(0, TEST_WORLD_SIZE / 4);
+  return result;
+}
+
+void test_query_region_matches_brute_force() {
+  for (size_t k = 0; k < N_TEST_KINDS; k++) {
+    srand(TEST_SEED);
+    scene_t *scene = scene_init();
+    scene_set_broadphase(scene, TEST_KINDS[k]);
+    for (size_t i = 0; i < TEST_BODIES; i++) {
+      // Some bodies are static, which the tree keeps apart
+      body_t *body = make_random_body(i % 3 == 0 ? INFINITY : 1);
+      if (i % 3 != 0)
+        body_set_velocity(body, (vector_t){.x = rand_range(-300, 300),
+                                           .y = rand_range(-300, 300)});
+      scene_add_body(scene, body);
+    }
+
+    for (size_t tick = 0; tick < TEST_TICKS; tick++) {
+      scene_tick(scene, 0.1);
+      for (size_t r = 0; r < TEST_REGIONS; r++) {
+        aabb_t region = make_random_region();
+        list_t *found = scene_query_region(scene, region);
+        size_t n_expected = 0;
+        for (size_t i = 0; i < scene_bodies(scene); i++) {
+          body_t *body = scene_get_body(scene, i);
+          bool overlaps = aabb_overlaps(body_get_aabb(body), region);
+          n_expected += overlaps;
+          size_t n_found = 0;
+          for (size_t j = 0; j < list_size(found); j++)
+            n_found += list_get(found, j) == body;
+          assert(n_found == (overlaps ? 1 : 0));
+        }
+        assert(list_size(found) == n_expected);
+        list_free(found);
+      }
+    }
+    scene_free(scene);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_find_pairs_matches_brute_force)
+  DO_TEST(test_tree_skips_static_pairs_until_moved)
+  DO_TEST(test_query_region_matches_brute_force)
+
+  puts("broadphase_test PASS");
+}
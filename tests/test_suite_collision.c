@@ -0,0 +1,459 @@
+#include "body.h"
+#include "collision.h"
+#include "polygon.h"
+#include "scene.h"
+#include "test_util.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * Randomized checks that the specialized narrowphase paths agree with the
+ * general ones they replace. Each test uses a fixed seed, so failures are
+ * reproducible.
+ */
+
+const unsigned TEST_SEED = 1;
+const rgb_color_t TEST_COLOR = {0, 0, 0};
+const size_t TEST_CIRCLE_POINTS = 20;
+
+typedef enum {
+  SHAPE_CIRCLE = 0,
+  SHAPE_RECTANGLE = 1,
+  SHAPE_POLYGON = 2,
+} shape_kind_t;
+
+// The collision handlers play sounds; the tests are silent
+int load_sound_effect(char *filename) { return 0; }
+
+char *get_sound_effect(void *sound) { return NULL; }
+
+double rand_range(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+int compare_doubles(const void *a, const void *b) {
+  double difference = *(const double *)a - *(const double *)b;
+  return (difference > 0) - (difference < 0);
+}
+
+/**
+ * Makes a random body of a given kind around center, with at most
+ * max_points vertices if it is a polygon, randomly rotated.
+ */
+body_t *make_random_body(shape_kind_t kind, vector_t center,
+                         size_t max_points) {
+  body_t *result;
+  if (kind == SHAPE_CIRCLE) {
+    result = body_init_circle(center, rand_range(2, 40), TEST_CIRCLE_POINTS, 1,
+                              TEST_COLOR);
+  } else if (kind == SHAPE_RECTANGLE) {
+    double half_width = rand_range(1, 40);
+    double half_height = rand_range(1, 40);
+    vector_t points[4] = {
+        {.x = center.x - half_width, .y = center.y - half_height},
+        {.x = center.x + half_width, .y = center.y - half_height},
+        {.x = center.x + half_width, .y = center.y + half_height},
+        {.x = center.x - half_width, .y = center.y + half_height}};
+    result = body_init_from_array(points, 4, 1, TEST_COLOR);
+  } else {
+    // Vertices at sorted random angles around an ellipse are convex
+    size_t n_points = 3 + rand() % (max_points - 2);
+    double angles[n_points];
+    for (size_t i = 0; i < n_points; i++)
+      angles[i] = rand_range(0, 2 * M_PI);
+    qsort(angles, n_points, sizeof(double), compare_doubles);
+    double radius_x = rand_range(2, 40);
+    double radius_y = rand_range(2, 40);
+    vector_t points[n_points];
+    for (size_t i = 0; i < n_points; i++) {
+      points[i].x = center.x + radius_x * cos(angles[i]);
+      points[i].y = center.y + radius_y * sin(angles[i]);
+    }
+    result = body_init_from_array(points, n_points, 1, TEST_COLOR);
+  }
+  body_set_rotation(result, rand_range(0, 2 * M_PI));
+  return result;
+}
+
+/**
+ * Makes a random body near the origin, close enough to often collide with
+ * another made the same way.
+ */
+body_t *make_nearby_body(size_t max_points) {
+  vector_t center = {.x = rand_range(-60, 60), .y = rand_range(-60, 60)};
+  return make_random_body(rand() % 3, center, max_points);
+}
+
+/**
+ * Strips a view of the cached data that selects the specialized paths,
+ * leaving a plain polygon (or circle) for the general tests.
+ */
+shape_view_t plain_view(shape_view_t view) {
+  view.normals = NULL;
+  view.half_extents = VEC_ZERO;
+  view.extreme_hints = NULL;
+  return view;
+}
+
+/**
+ * Projects a shape onto a unit axis by visiting every vertex,
+ * or from its center if it is a circle.
+ * Returns the smallest projection as x and the largest as y.
+ */
+vector_t project_onto(shape_view_t shape, vector_t axis) {
+  if (shape.radius > 0) {
+    double center = vec_dot(shape.center, axis);
+    vector_t result = {.x = center - shape.radius, .y = center + shape.radius};
+    return result;
+  }
+  vector_t result = {.x = INFINITY, .y = -INFINITY};
+  for (size_t i = 0; i < shape.size; i++) {
+    double value = vec_dot(shape.points[i], axis);
+    result.x = fmin(result.x, value);
+    result.y = fmax(result.y, value);
+  }
+  return result;
+}
+
+/**
+ * Returns whether one shape's projection onto an axis contains the other's.
+ * The separating axis tests then measure the overlap as the inner shape's
+ * width, which ties on every axis when a circle is inside a polygon,
+ * so the axis they pick is decided by rounding.
+ */
+bool projections_nest(shape_view_t shape1, shape_view_t shape2,
+                      vector_t axis) {
+  vector_t range1 = project_onto(shape1, axis);
+  vector_t range2 = project_onto(shape2, axis);
+  return (range1.x <= range2.x && range2.y <= range1.y) ||
+         (range2.x <= range1.x && range1.y <= range2.y);
+}
+
+void test_box_matches_generic_sat() {
+  srand(TEST_SEED);
+  size_t n_compared = 0;
+  for (size_t i = 0; i < 20000; i++) {
+    body_t *body1 = make_nearby_body(12);
+    body_t *body2 = make_nearby_body(12);
+    shape_view_t view1 = body_get_shape_view(body1);
+    shape_view_t view2 = body_get_shape_view(body2);
+    collision_info_t fast = find_collision_view(view1, view2);
+    collision_info_t plain =
+        find_collision_view(plain_view(view1), plain_view(view2));
+    // Projecting a box from its center differs from projecting its vertices
+    // by rounding, which only matters for shapes that barely touch
+    if (fast.collided != plain.collided) {
+      double depth = fast.collided ? fast.depth : plain.depth;
+      assert(depth < 1e-9);
+    } else if (fast.collided && !projections_nest(view1, view2, plain.axis)) {
+      assert(within(1e-9, fast.depth, plain.depth));
+      if (view1.half_extents.x > 0 || view2.half_extents.x > 0)
+        n_compared++;
+    }
+    body_free(body1);
+    body_free(body2);
+  }
+  // Enough colliding pairs with a box must have been compared
+  assert(n_compared > 1000);
+}
+
+/**
+ * Returns whether a point lies in a box grown by margin on every side.
+ */
+bool aabb_contains_point(aabb_t box, vector_t point, double margin) {
+  return box.min.x - margin <= point.x && point.x <= box.max.x + margin &&
+         box.min.y - margin <= point.y && point.y <= box.max.y + margin;
+}
+
+void test_depth_separates_and_contacts_touch() {
+  srand(TEST_SEED);
+  size_t n_collided = 0;
+  for (size_t i = 0; i < 20000; i++) {
+    body_t *body1 = make_nearby_body(12);
+    body_t *body2 = make_nearby_body(12);
+    collision_info_t collision = find_collision_view(
+        body_get_shape_view(body1), body_get_shape_view(body2));
+    if (!collision.collided) {
+      body_free(body1);
+      body_free(body2);
+      continue;
+    }
+    n_collided++;
+    assert(collision.depth > 0);
+    assert(isclose(vec_dot(collision.axis, collision.axis), 1));
+    assert(collision.n_contacts == 1 || collision.n_contacts == 2);
+    // The contacts lie where the shapes overlap, give or take the depth,
+    // unless the axis was picked by rounding (see projections_nest())
+    bool nested = projections_nest(body_get_shape_view(body1),
+                                   body_get_shape_view(body2), collision.axis);
+    double margin = collision.depth + 1e-6;
+    for (size_t j = 0; !nested && j < collision.n_contacts; j++) {
+      assert(aabb_contains_point(body_get_aabb(body1), collision.contacts[j],
+                           margin));
+      assert(aabb_contains_point(body_get_aabb(body2), collision.contacts[j],
+                           margin));
+    }
+    // Moving the second shape along the axis by just over the depth
+    // separates the shapes
+    vector_t push = vec_multiply(collision.depth + 1e-6, collision.axis);
+    body_set_centroid(body2, vec_add(body_get_centroid(body2), push));
+    assert(!find_collision_view(body_get_shape_view(body1),
+                                body_get_shape_view(body2))
+                .collided);
+    body_free(body1);
+    body_free(body2);
+  }
+  assert(n_collided > 1000);
+}
+
+/**
+ * Returns how far two polygons must move apart along a unit axis to stop
+ * overlapping on it, which is negative if the axis separates them.
+ */
+double penetration_along(shape_view_t shape1, shape_view_t shape2,
+                         vector_t axis) {
+  vector_t range1 = project_onto(shape1, axis);
+  vector_t range2 = project_onto(shape2, axis);
+  return fmin(range1.y - range2.x, range2.y - range1.x);
+}
+
+/**
+ * Finds the least penetration of two polygons over every edge normal of
+ * both, which is their minimum translation distance if it is positive.
+ */
+double min_penetration(shape_view_t shape1, shape_view_t shape2) {
+  double result = INFINITY;
+  shape_view_t shapes[2] = {shape1, shape2};
+  for (size_t i = 0; i < 2; i++) {
+    shape_view_t edges = shapes[i];
+    for (size_t j = 0; j < edges.size; j++) {
+      vector_t axis = polygon_edge_normal(edges.points[j],
+                                          edges.points[(j + 1) % edges.size]);
+      result = fmin(result, penetration_along(shape1, shape2, axis));
+    }
+  }
+  return result;
+}
+
+void test_gjk_depth_matches_brute_force() {
+  srand(TEST_SEED);
+  size_t n_collided = 0;
+  for (size_t i = 0; i < 5000; i++) {
+    // Polygons with up to a couple of hundred vertices, mostly enough
+    // together to be tested with GJK
+    vector_t center1 = {.x = rand_range(-60, 60), .y = rand_range(-60, 60)};
+    vector_t center2 = {.x = rand_range(-60, 60), .y = rand_range(-60, 60)};
+    body_t *body1 = make_random_body(SHAPE_POLYGON, center1, 200);
+    body_t *body2 = make_random_body(SHAPE_POLYGON, center2, 200);
+    shape_view_t view1 = body_get_shape_view(body1);
+    shape_view_t view2 = body_get_shape_view(body2);
+    collision_info_t collision = find_collision_view(view1, view2);
+    double expected = min_penetration(view1, view2);
+    // Shapes that barely touch may go either way
+    if (fabs(expected) > 1e-9)
+      assert(collision.collided == (expected > 0));
+    // Pairs left to the separating axis tests may pick another axis
+    // (see projections_nest())
+    if (collision.collided &&
+        !projections_nest(view1, view2, collision.axis)) {
+      n_collided++;
+      assert(within(1e-6, penetration_along(view1, view2, collision.axis),
+                    expected));
+    }
+    body_free(body1);
+    body_free(body2);
+  }
+  assert(n_collided > 1000);
+}
+
+/**
+ * Moves a body so its centroid is a fraction of the way along a motion
+ * that ends at end.
+ */
+void place_along(body_t *body, vector_t end, vector_t displacement,
+                 double fraction) {
+  vector_t back = vec_multiply(1 - fraction, displacement);
+  body_set_centroid(body, vec_subtract(end, back));
+}
+
+void test_time_of_impact_matches_sampling() {
+  srand(TEST_SEED);
+  const size_t n_samples = 200;
+  size_t n_hits = 0;
+  for (size_t i = 0; i < 5000; i++) {
+    body_t *body1 = make_nearby_body(12);
+    body_t *body2 = make_nearby_body(12);
+    vector_t end = body_get_centroid(body1);
+    vector_t displacement = {.x = rand_range(-150, 150),
+                             .y = rand_range(-150, 150)};
+    double impact = find_time_of_impact(body_get_shape_view(body1),
+                                        displacement,
+                                        body_get_shape_view(body2));
+    // No sample before the time of impact overlaps by more than rounding
+    double first_hit = INFINITY;
+    for (size_t j = 0; j <= n_samples && first_hit == INFINITY; j++) {
+      double fraction = (double)j / n_samples;
+      place_along(body1, end, displacement, fraction);
+      collision_info_t collision = find_collision_view(
+          body_get_shape_view(body1), body_get_shape_view(body2));
+      if (collision.collided && collision.depth > 1e-6)
+        first_hit = fraction;
+    }
+    assert(first_hit >= impact);
+    // and the shapes overlap just after it, unless they only graze
+    if (impact < 1) {
+      n_hits++;
+      place_along(body1, end, displacement, fmin(impact + 1e-6, 1));
+      assert(find_collision_view(body_get_shape_view(body1),
+                                 body_get_shape_view(body2))
+                 .collided ||
+             first_hit == INFINITY);
+    }
+    body_free(body1);
+    body_free(body2);
+  }
+  assert(n_hits > 1000);
+}
+
+void record_collision(body_t *body1, body_t *body2, vector_t axis, void *aux) {
+  *(bool *)aux = true;
+}
+
+/**
+ * Adds a body moving at a velocity to a scene.
+ */
+body_t *add_moving_body(scene_t *scene, body_t *body, vector_t velocity) {
+  body_set_velocity(body, velocity);
+  scene_add_body(scene, body);
+  return body;
+}
+
+void test_bullet_hits_moving_body() {
+  // A bullet and a wall moving towards each other cross within one tick,
+  // and neither is where the other ends up
+  scene_t *scene = scene_init();
+  vector_t wall_points[4] = {{.x = 58, .y = -50},
+                             {.x = 62, .y = -50},
+                             {.x = 62, .y = 50},
+                             {.x = 58, .y = 50}};
+  body_t *bullet =
+      add_moving_body(scene, body_init_circle(VEC_ZERO, 5, TEST_CIRCLE_POINTS,
+                                              1, TEST_COLOR),
+                      (vector_t){.x = 100, .y = 0});
+  body_t *wall = add_moving_body(
+      scene, body_init_from_array(wall_points, 4, 1, TEST_COLOR),
+      (vector_t){.x = -100, .y = 0});
+  body_set_bullet(bullet, true);
+  bool collided = false;
+  scene_add_collision_handler(scene, bullet, wall, record_collision, &collided,
+                              NULL, false);
+  scene_tick(scene, 1);
+  // The bullet is stopped just inside where the wall ended up
+  assert(scene_find_collision(scene, bullet, wall).collided);
+  assert(body_get_centroid(bullet).x < body_get_centroid(wall).x);
+  scene_tick(scene, 1e-3);
+  assert(collided);
+  scene_free(scene);
+
+  // Two bullets that cross each other both stop where they met
+  scene = scene_init();
+  body_t *bullet1 =
+      add_moving_body(scene, body_init_circle(VEC_ZERO, 5, TEST_CIRCLE_POINTS,
+                                              1, TEST_COLOR),
+                      (vector_t){.x = 100, .y = 0});
+  body_t *bullet2 = add_moving_body(
+      scene,
+      body_init_circle((vector_t){.x = 60, .y = 0}, 5, TEST_CIRCLE_POINTS, 1,
+                       TEST_COLOR),
+      (vector_t){.x = -100, .y = 0});
+  body_set_bullet(bullet1, true);
+  body_set_bullet(bullet2, true);
+  collided = false;
+  scene_add_collision_handler(scene, bullet1, bullet2, record_collision,
+                              &collided, NULL, false);
+  scene_tick(scene, 1);
+  assert(within(1e-9, body_get_centroid(bullet1).x,
+                60 - body_get_centroid(bullet2).x));
+  assert(body_get_centroid(bullet1).x < body_get_centroid(bullet2).x);
+  scene_tick(scene, 1e-3);
+  assert(collided);
+  scene_free(scene);
+}
+
+void test_find_extreme_matches_full_scan() {
+  srand(TEST_SEED);
+  size_t n_hinted = 0;
+  for (size_t i = 0; i < 2000; i++) {
+    vector_t center = {.x = rand_range(-60, 60), .y = rand_range(-60, 60)};
+    body_t *body = make_random_body(SHAPE_POLYGON, center, 200);
+    shape_view_t view = body_get_shape_view(body);
+    if (view.extreme_hints != NULL)
+      n_hinted++;
+    // Directions turning a little at a time reuse the hints, and random
+    // ones jump between them
+    double angle = rand_range(0, 2 * M_PI);
+    for (size_t j = 0; j < 100; j++) {
+      angle += j % 2 == 0 ? rand_range(-0.1, 0.1) : rand_range(0, 2 * M_PI);
+      vector_t direction = {.x = cos(angle), .y = sin(angle)};
+      size_t extreme = polygon_find_extreme(view, direction);
+      assert(extreme < view.size);
+      double expected = project_onto(view, direction).y;
+      assert(within(1e-9, vec_dot(view.points[extreme], direction), expected));
+    }
+    body_free(body);
+  }
+  assert(n_hinted > 1000);
+}
+
+void test_is_convex_rejects_non_convex() {
+  vector_t square[4] = {
+      {.x = 0, .y = 0}, {.x = 1, .y = 0}, {.x = 1, .y = 1}, {.x = 0, .y = 1}};
+  assert(polygon_is_convex_array(square, 4));
+  vector_t clockwise[4] = {
+      {.x = 0, .y = 0}, {.x = 0, .y = 1}, {.x = 1, .y = 1}, {.x = 1, .y = 0}};
+  assert(polygon_is_convex_array(clockwise, 4));
+  vector_t collinear[5] = {{.x = 0, .y = 0},
+                           {.x = 0.5, .y = 0},
+                           {.x = 1, .y = 0},
+                           {.x = 1, .y = 1},
+                           {.x = 0, .y = 1}};
+  assert(!polygon_is_convex_array(collinear, 5));
+  vector_t repeated[5] = {{.x = 0, .y = 0},
+                          {.x = 1, .y = 0},
+                          {.x = 1, .y = 0},
+                          {.x = 1, .y = 1},
+                          {.x = 0, .y = 1}};
+  assert(!polygon_is_convex_array(repeated, 5));
+  vector_t arrow[4] = {
+      {.x = 0, .y = 0}, {.x = 2, .y = 1}, {.x = 0, .y = 2}, {.x = 1, .y = 1}};
+  assert(!polygon_is_convex_array(arrow, 4));
+  // A star turns the same way at every vertex but winds around twice
+  vector_t star[5];
+  for (size_t i = 0; i < 5; i++) {
+    star[i].x = cos(4 * M_PI * i / 5);
+    star[i].y = sin(4 * M_PI * i / 5);
+  }
+  assert(!polygon_is_convex_array(star, 5));
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_box_matches_generic_sat)
+  DO_TEST(test_depth_separates_and_contacts_touch)
+  DO_TEST(test_gjk_depth_matches_brute_force)
+  DO_TEST(test_time_of_impact_matches_sampling)
+  DO_TEST(test_bullet_hits_moving_body)
+  DO_TEST(test_find_extreme_matches_full_scan)
+  DO_TEST(test_is_convex_rejects_non_convex)
+
+  puts("collision_test PASS");
+}
@@ -0,0 +1,137 @@
+#include "list.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+/*
+ * Checks the bulk and unordered list operations: which elements they keep,
+ * in what order, and which they pass to the list's freer.
+ */
+
+#define TEST_N_VALUES 10
+
+// The collision handlers play sounds; the tests are silent
+int load_sound_effect(char *filename) { return 0; }
+
+char *get_sound_effect(void *sound) { return NULL; }
+
+// The elements of the lists are pointers into this array
+int test_values[TEST_N_VALUES] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+// The elements passed to count_free(), in the order it got them
+int *freed[TEST_N_VALUES];
+size_t n_freed = 0;
+
+void count_free(void *item) {
+  assert(n_freed < TEST_N_VALUES);
+  freed[n_freed++] = (int *)item;
+}
+
+/**
+ * Makes a list of the first n values, in order, that records what it frees.
+ */
+list_t *make_list(size_t n) {
+  list_t *result = list_init(n, count_free);
+  for (size_t i = 0; i < n; i++)
+    list_add(result, &test_values[i]);
+  n_freed = 0;
+  return result;
+}
+
+/**
+ * Asserts that a list holds exactly the given values, in order.
+ */
+void assert_values(list_t *list, const int *values, size_t n) {
+  assert(list_size(list) == n);
+  for (size_t i = 0; i < n; i++)
+    assert(*(int *)list_get(list, i) == values[i]);
+}
+
+bool is_multiple(void *item, void *aux) {
+  return *(int *)item % *(int *)aux == 0;
+}
+
+bool is_negative(void *item, void *aux) { return *(int *)item < 0; }
+
+void test_remove_if_keeps_order() {
+  list_t *list = make_list(TEST_N_VALUES);
+  // Multiples of 3 include the first and last elements
+  int divisor = 3;
+  assert(list_remove_if(list, is_multiple, &divisor) == 4);
+  const int kept[] = {1, 2, 4, 5, 7, 8};
+  assert_values(list, kept, 6);
+  // Each removed element is freed once, in the order they were in the list
+  const int removed[] = {0, 3, 6, 9};
+  assert(n_freed == 4);
+  for (size_t i = 0; i < n_freed; i++)
+    assert(*freed[i] == removed[i]);
+
+  n_freed = 0;
+  assert(list_remove_if(list, is_negative, NULL) == 0);
+  assert_values(list, kept, 6);
+  assert(n_freed == 0);
+
+  divisor = 1;
+  assert(list_remove_if(list, is_multiple, &divisor) == 6);
+  assert(list_size(list) == 0);
+  assert(n_freed == 6);
+  list_free(list);
+}
+
+void test_swap_remove_at_ends() {
+  list_t *list = make_list(5);
+  // Removing the last element moves nothing
+  assert(*(int *)list_swap_remove(list, 4) == 4);
+  const int after_last[] = {0, 1, 2, 3};
+  assert_values(list, after_last, 4);
+  // Removing the first element moves the last into its place
+  assert(*(int *)list_swap_remove(list, 0) == 0);
+  const int after_first[] = {3, 1, 2};
+  assert_values(list, after_first, 3);
+  assert(*(int *)list_swap_remove(list, 1) == 1);
+  const int after_middle[] = {3, 2};
+  assert_values(list, after_middle, 2);
+  assert(*(int *)list_swap_remove(list, 1) == 2);
+  assert(*(int *)list_swap_remove(list, 0) == 3);
+  assert(list_size(list) == 0);
+  // The removed elements are returned, not freed
+  assert(n_freed == 0);
+  list_free(list);
+  assert(n_freed == 0);
+}
+
+void test_append_array_keeps_order() {
+  // Starting small, so the list must grow to fit the arrays
+  list_t *list = list_init(1, count_free);
+  n_freed = 0;
+  void *items[TEST_N_VALUES];
+  for (size_t i = 0; i < TEST_N_VALUES; i++)
+    items[i] = &test_values[i];
+  list_append_array(list, items, 3);
+  const int first[] = {0, 1, 2};
+  assert_values(list, first, 3);
+  list_append_array(list, items, 0);
+  assert_values(list, first, 3);
+  // Appending to a list that is not empty keeps its elements first
+  list_append_array(list, items + 3, TEST_N_VALUES - 3);
+  assert_values(list, test_values, TEST_N_VALUES);
+  assert(n_freed == 0);
+  list_free(list);
+  assert(n_freed == TEST_N_VALUES);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_remove_if_keeps_order)
+  DO_TEST(test_swap_remove_at_ends)
+  DO_TEST(test_append_array_keeps_order)
+
+  puts("list_test PASS");
+}
@@ -0,0 +1,405 @@
+#include "body.h"
+#include "collision.h"
+#include "forces.h"
+#include "pair_manager.h"
+#include "scene.h"
+#include "test_util.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * Checks the contact solver, the contact states and handler dispatch of
+ * collision pairs, and the narrowphase cache, through small scripted scenes.
+ */
+
+const rgb_color_t TEST_COLOR = {0, 0, 0};
+const size_t TEST_CIRCLE_POINTS = 20;
+const double TEST_DT = 0.01;
+const double TEST_GRAVITY = -100;
+const double TEST_BOX_SIZE = 10;
+// How far resting bodies start inside each other, within the correction slop
+const double TEST_REST_OVERLAP = 0.05;
+const size_t TEST_STACK_HEIGHT = 4;
+const size_t TEST_SETTLE_TICKS = 30;
+const size_t TEST_SETTLE_ITERATIONS = 50;
+const double TEST_VELOCITY_TOLERANCE = 1e-3;
+#define TEST_MAX_CALLS 16
+
+// The collision handlers play sounds; the tests are silent
+int load_sound_effect(char *filename) { return 0; }
+
+char *get_sound_effect(void *sound) { return NULL; }
+
+body_t *make_box(vector_t center, double width, double height, double mass) {
+  vector_t points[4] = {
+      {.x = center.x - width / 2, .y = center.y - height / 2},
+      {.x = center.x + width / 2, .y = center.y - height / 2},
+      {.x = center.x + width / 2, .y = center.y + height / 2},
+      {.x = center.x - width / 2, .y = center.y + height / 2}};
+  return body_init_from_array(points, 4, mass, TEST_COLOR);
+}
+
+/**
+ * Makes a static ledge whose top is at y = 0.
+ */
+body_t *make_ledge(void) {
+  return make_box((vector_t){0, -TEST_BOX_SIZE}, 20 * TEST_BOX_SIZE,
+                  2 * TEST_BOX_SIZE, INFINITY);
+}
+
+/**
+ * Makes a scene with a stack of boxes resting on a static ledge under
+ * gravity, each solid to the bodies above and below it. The boxes start at
+ * the given centroids and velocities, from the bottom up.
+ */
+scene_t *make_stack(const vector_t *centroids, const vector_t *velocities) {
+  scene_t *scene = scene_init();
+  body_t *below = make_ledge();
+  scene_add_body(scene, below);
+  for (size_t i = 0; i < TEST_STACK_HEIGHT; i++) {
+    body_t *box = make_box(centroids[i], TEST_BOX_SIZE, TEST_BOX_SIZE, 1);
+    body_set_velocity(box, velocities[i]);
+    scene_add_body(scene, box);
+    scene_set_collision_solid(scene, below, box, 0);
+    create_universal_gravity(scene, box, TEST_GRAVITY);
+    below = box;
+  }
+  return scene;
+}
+
+/**
+ * Makes a stack of boxes, each overlapping the one below a little,
+ * and lets it settle with a converged solver.
+ */
+scene_t *make_settled_stack(void) {
+  vector_t centroids[TEST_STACK_HEIGHT];
+  vector_t velocities[TEST_STACK_HEIGHT];
+  for (size_t i = 0; i < TEST_STACK_HEIGHT; i++) {
+    centroids[i] = (vector_t){
+        0, TEST_BOX_SIZE / 2 + i * TEST_BOX_SIZE - (i + 1) * TEST_REST_OVERLAP};
+    velocities[i] = VEC_ZERO;
+  }
+  scene_t *scene = make_stack(centroids, velocities);
+  scene_set_solver_iterations(scene, TEST_SETTLE_ITERATIONS);
+  for (size_t i = 0; i < TEST_SETTLE_TICKS; i++)
+    scene_tick(scene, TEST_DT);
+  return scene;
+}
+
+/**
+ * Gets the fastest vertical speed of the boxes in a stack.
+ */
+double stack_residual(scene_t *scene) {
+  double result = 0;
+  // Body 0 is the ledge
+  for (size_t i = 1; i < scene_bodies(scene); i++)
+    result = fmax(result, fabs(body_get_velocity(scene_get_body(scene, i)).y));
+  return result;
+}
+
+/**
+ * Gets the fewest solver iterations with which the tick after a stack
+ * settles leaves every box at rest, either continuing the settled scene,
+ * whose contacts persist, or from a copy of it with new contacts.
+ */
+size_t stack_iterations_to_rest(bool warm) {
+  for (size_t iterations = 0; iterations < TEST_SETTLE_ITERATIONS;
+       iterations++) {
+    scene_t *scene = make_settled_stack();
+    if (!warm) {
+      vector_t centroids[TEST_STACK_HEIGHT];
+      vector_t velocities[TEST_STACK_HEIGHT];
+      for (size_t i = 0; i < TEST_STACK_HEIGHT; i++) {
+        body_t *box = scene_get_body(scene, i + 1);
+        centroids[i] = body_get_centroid(box);
+        velocities[i] = body_get_velocity(box);
+      }
+      scene_free(scene);
+      scene = make_stack(centroids, velocities);
+    }
+    scene_set_solver_iterations(scene, iterations);
+    scene_tick(scene, TEST_DT);
+    double residual = stack_residual(scene);
+    scene_free(scene);
+    if (residual < TEST_VELOCITY_TOLERANCE)
+      return iterations;
+  }
+  return TEST_SETTLE_ITERATIONS;
+}
+
+/**
+ * A collision handler call, as recorded by record_call().
+ */
+typedef struct handler_call {
+  size_t handler;
+  body_t *body1;
+  body_t *body2;
+  vector_t axis;
+} handler_call_t;
+
+typedef struct call_log {
+  handler_call_t calls[TEST_MAX_CALLS];
+  size_t n_calls;
+} call_log_t;
+
+// Tells a recording handler its index and where to record its calls
+typedef struct call_recorder {
+  call_log_t *log;
+  size_t handler;
+} call_recorder_t;
+
+call_recorder_t *call_recorder_init(call_log_t *log, size_t handler) {
+  call_recorder_t *result = malloc(sizeof(call_recorder_t));
+  assert(result);
+  result->log = log;
+  result->handler = handler;
+  return result;
+}
+
+void record_call(body_t *body1, body_t *body2, vector_t axis, void *aux) {
+  call_recorder_t *recorder = (call_recorder_t *)aux;
+  call_log_t *log = recorder->log;
+  assert(log->n_calls < TEST_MAX_CALLS);
+  log->calls[log->n_calls++] = (handler_call_t){.handler = recorder->handler,
+                                                .body1 = body1,
+                                                .body2 = body2,
+                                                .axis = axis};
+}
+
+/**
+ * Asserts that a logged call was made by a given handler with the bodies
+ * in the given order, and an axis pointing from the first to the second.
+ */
+void assert_call(handler_call_t call, size_t handler, body_t *body1,
+                 body_t *body2) {
+  assert(call.handler == handler);
+  assert(call.body1 == body1 && call.body2 == body2);
+  vector_t direction =
+      vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
+  assert(vec_dot(call.axis, direction) > 0);
+}
+
+void test_resting_box_stops_in_one_iteration() {
+  scene_t *scene = scene_init();
+  body_t *ledge = make_ledge();
+  vector_t start = {0, TEST_BOX_SIZE / 2 - TEST_REST_OVERLAP};
+  body_t *box = make_box(start, TEST_BOX_SIZE, TEST_BOX_SIZE, 1);
+  scene_add_body(scene, ledge);
+  scene_add_body(scene, box);
+  scene_set_collision_solid(scene, ledge, box, 0.5);
+  create_universal_gravity(scene, box, TEST_GRAVITY);
+  // A single contact is solved exactly by a single pass
+  scene_set_solver_iterations(scene, 1);
+  for (size_t i = 0; i < TEST_SETTLE_TICKS; i++) {
+    scene_tick(scene, TEST_DT);
+    assert(within(1e-9, body_get_velocity(box).y, 0));
+    assert(vec_within(1e-9, body_get_centroid(box), start));
+    assert(scene_get_collision_state(scene, ledge, box) ==
+           (i == 0 ? PAIR_BEGIN : PAIR_PERSIST));
+  }
+  scene_free(scene);
+}
+
+void test_elastic_pair_swaps_velocities() {
+  scene_t *scene = scene_init();
+  // Approaching much faster than the restitution threshold
+  body_t *left = body_init_circle((vector_t){-9.9, 0}, 10, TEST_CIRCLE_POINTS,
+                                  2, TEST_COLOR);
+  body_t *right = body_init_circle((vector_t){9.9, 0}, 10, TEST_CIRCLE_POINTS,
+                                   2, TEST_COLOR);
+  body_set_velocity(left, (vector_t){100, 0});
+  body_set_velocity(right, (vector_t){-30, 0});
+  scene_add_body(scene, left);
+  scene_add_body(scene, right);
+  scene_set_collision_solid(scene, left, right, 1);
+  scene_tick(scene, TEST_DT);
+  assert(vec_isclose(body_get_velocity(left), (vector_t){-30, 0}));
+  assert(vec_isclose(body_get_velocity(right), (vector_t){100, 0}));
+  scene_free(scene);
+
+  // With unequal masses, momentum is kept and the relative velocity reversed
+  scene = scene_init();
+  left = body_init_circle((vector_t){-9.9, 0}, 10, TEST_CIRCLE_POINTS, 1,
+                          TEST_COLOR);
+  right = body_init_circle((vector_t){9.9, 0}, 10, TEST_CIRCLE_POINTS, 3,
+                           TEST_COLOR);
+  body_set_velocity(left, (vector_t){100, 0});
+  body_set_velocity(right, (vector_t){-100, 0});
+  scene_add_body(scene, left);
+  scene_add_body(scene, right);
+  scene_set_collision_solid(scene, left, right, 1);
+  scene_tick(scene, TEST_DT);
+  vector_t velocity1 = body_get_velocity(left);
+  vector_t velocity2 = body_get_velocity(right);
+  assert(isclose(1 * velocity1.x + 3 * velocity2.x, 1 * 100 + 3 * -100));
+  assert(isclose(velocity2.x - velocity1.x, 200));
+  assert(vec_isclose(velocity1, (vector_t){-200, 0}));
+  assert(vec_isclose(velocity2, VEC_ZERO));
+  scene_free(scene);
+}
+
+void test_slow_contacts_do_not_bounce() {
+  scene_t *scene = scene_init();
+  // Approaching slower than the restitution threshold
+  body_t *left = body_init_circle((vector_t){-9.9, 0}, 10, TEST_CIRCLE_POINTS,
+                                  1, TEST_COLOR);
+  body_t *right = body_init_circle((vector_t){9.9, 0}, 10, TEST_CIRCLE_POINTS,
+                                   1, TEST_COLOR);
+  body_set_velocity(left, (vector_t){2, 0});
+  body_set_velocity(right, (vector_t){-2, 0});
+  scene_add_body(scene, left);
+  scene_add_body(scene, right);
+  scene_set_collision_solid(scene, left, right, 1);
+  scene_tick(scene, TEST_DT);
+  assert(vec_isclose(body_get_velocity(left), VEC_ZERO));
+  assert(vec_isclose(body_get_velocity(right), VEC_ZERO));
+  scene_free(scene);
+}
+
+void test_separating_contacts_are_not_pulled_together() {
+  scene_t *scene = scene_init();
+  body_t *left = body_init_circle((vector_t){-9.9, 0}, 10, TEST_CIRCLE_POINTS,
+                                  1, TEST_COLOR);
+  body_t *right = body_init_circle((vector_t){9.9, 0}, 10, TEST_CIRCLE_POINTS,
+                                   1, TEST_COLOR);
+  body_set_velocity(left, (vector_t){-50, 0});
+  body_set_velocity(right, (vector_t){50, 0});
+  scene_add_body(scene, left);
+  scene_add_body(scene, right);
+  scene_set_collision_solid(scene, left, right, 1);
+  scene_tick(scene, TEST_DT);
+  assert(scene_get_collision_state(scene, left, right) == PAIR_BEGIN);
+  assert(vec_equal(body_get_velocity(left), (vector_t){-50, 0}));
+  assert(vec_equal(body_get_velocity(right), (vector_t){50, 0}));
+  scene_free(scene);
+}
+
+void test_warm_start_converges_faster() {
+  size_t warm = stack_iterations_to_rest(true);
+  size_t cold = stack_iterations_to_rest(false);
+  // A stack needs several passes to spread its weight down to the ledge
+  assert(cold > 1 && cold < TEST_SETTLE_ITERATIONS);
+  assert(warm < cold);
+}
+
+void test_pair_states_and_handlers_follow_script() {
+  scene_t *scene = scene_init();
+  body_t *left = body_init_circle(VEC_ZERO, 10, TEST_CIRCLE_POINTS, 1,
+                                  TEST_COLOR);
+  body_t *right = body_init_circle(VEC_ZERO, 10, TEST_CIRCLE_POINTS, 1,
+                                   TEST_COLOR);
+  scene_add_body(scene, left);
+  scene_add_body(scene, right);
+  call_log_t log = {.n_calls = 0};
+  // Handlers 1 and 2 get the bodies reversed, and handler 1 only sees the
+  // start of each collision
+  scene_add_collision_handler(scene, left, right, record_call,
+                              call_recorder_init(&log, 0), free, true);
+  scene_add_collision_handler(scene, right, left, record_call,
+                              call_recorder_init(&log, 1), free, false);
+  scene_add_collision_handler(scene, right, left, record_call,
+                              call_recorder_init(&log, 2), free, true);
+
+  // How far apart the centers are on each tick
+  const double distances[] = {25, 15, 15, 25, 25, 15};
+  const pair_state_t states[] = {PAIR_SEPARATED, PAIR_BEGIN,
+                                 PAIR_PERSIST,   PAIR_END,
+                                 PAIR_SEPARATED, PAIR_BEGIN};
+  const size_t n_calls[] = {0, 3, 2, 0, 0, 3};
+  for (size_t tick = 0; tick < sizeof(distances) / sizeof(distances[0]);
+       tick++) {
+    body_set_centroid(left, (vector_t){-distances[tick] / 2, 0});
+    body_set_centroid(right, (vector_t){distances[tick] / 2, 0});
+    log.n_calls = 0;
+    scene_tick(scene, TEST_DT);
+    assert(scene_get_collision_state(scene, left, right) == states[tick]);
+    assert(scene_get_collision_state(scene, right, left) == states[tick]);
+    assert(log.n_calls == n_calls[tick]);
+    // Handlers run in the order they were registered
+    if (states[tick] == PAIR_BEGIN) {
+      assert_call(log.calls[0], 0, left, right);
+      assert_call(log.calls[1], 1, right, left);
+      assert_call(log.calls[2], 2, right, left);
+    } else if (states[tick] == PAIR_PERSIST) {
+      assert_call(log.calls[0], 0, left, right);
+      assert_call(log.calls[1], 2, right, left);
+    }
+  }
+  scene_free(scene);
+}
+
+void test_swapped_lookup_negates_axis() {
+  scene_t *scene = scene_init();
+  body_t *box1 = make_box(VEC_ZERO, TEST_BOX_SIZE, TEST_BOX_SIZE, 1);
+  body_t *box2 = make_box((vector_t){8, 3}, TEST_BOX_SIZE, TEST_BOX_SIZE, 1);
+  body_set_rotation(box2, 0.3);
+  scene_add_body(scene, box1);
+  scene_add_body(scene, box2);
+  scene_tick(scene, TEST_DT);
+  collision_info_t collision1 = scene_find_collision(scene, box1, box2);
+  // The second lookup is the first's memoized result, seen the other way
+  collision_info_t collision2 = scene_find_collision(scene, box2, box1);
+  assert(collision1.collided && collision2.collided);
+  assert(vec_dot(collision1.axis, body_get_centroid(box2)) > 0);
+  assert(vec_equal(collision2.axis, vec_negate(collision1.axis)));
+  assert(collision2.depth == collision1.depth);
+  scene_free(scene);
+}
+
+/**
+ * Moves the second body out of the first from inside a collision handler,
+ * after the update has memoized their collision, and checks the scene
+ * sees the move.
+ */
+void move_apart(body_t *body1, body_t *body2, vector_t axis, void *aux) {
+  scene_t *scene = (scene_t *)aux;
+  assert(scene_find_collision(scene, body1, body2).collided);
+  // Diagonally apart, where the circles' bounding boxes still overlap
+  body_set_centroid(body2, vec_add(body_get_centroid(body1),
+                                   (vector_t){16, 16}));
+  assert(aabb_overlaps(body_get_aabb(body1), body_get_aabb(body2)));
+  assert(!scene_find_collision(scene, body1, body2).collided);
+  assert(!scene_find_collision(scene, body2, body1).collided);
+}
+
+void test_moving_body_invalidates_memo() {
+  scene_t *scene = scene_init();
+  body_t *circle1 = body_init_circle(VEC_ZERO, 10, TEST_CIRCLE_POINTS, 1,
+                                     TEST_COLOR);
+  body_t *circle2 = body_init_circle((vector_t){15, 0}, 10,
+                                     TEST_CIRCLE_POINTS, 1, TEST_COLOR);
+  scene_add_body(scene, circle1);
+  scene_add_body(scene, circle2);
+  scene_add_collision_handler(scene, circle1, circle2, move_apart, scene,
+                              NULL, true);
+  scene_tick(scene, TEST_DT);
+  assert(scene_get_collision_state(scene, circle1, circle2) == PAIR_BEGIN);
+  assert(vec_equal(body_get_centroid(circle2), (vector_t){16, 16}));
+  // The next update tests the moved body afresh
+  scene_tick(scene, TEST_DT);
+  assert(scene_get_collision_state(scene, circle1, circle2) == PAIR_END);
+  scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_resting_box_stops_in_one_iteration)
+  DO_TEST(test_elastic_pair_swaps_velocities)
+  DO_TEST(test_slow_contacts_do_not_bounce)
+  DO_TEST(test_separating_contacts_are_not_pulled_together)
+  DO_TEST(test_warm_start_converges_faster)
+  DO_TEST(test_pair_states_and_handlers_follow_script)
+  DO_TEST(test_swapped_lookup_negates_axis)
+  DO_TEST(test_moving_body_invalidates_memo)
+
+  puts("pair_manager_test PASS");
+}